@@ -294,7 +294,7 @@ public:
         int pos;
 
         for (pos = 0; pos < 16; pos++)
-            sprintf_s(digestChars + (pos * 2),3, "%02x", digestRaw[pos]);
+            snprintf(digestChars + (pos * 2), 3, "%02x", digestRaw[pos]);
     }
 
 
@@ -317,11 +317,15 @@ public:
         int len;
         unsigned char buffer[1024];
 
-        if ((fopen_s(&file,filename, "rb")) == NULL)
+#ifdef _WIN32
+        if (fopen_s(&file, filename, "rb") != 0)
+#else
+        if ((file = fopen(filename, "rb")) == NULL)
+#endif
             printf("%s can't be opened\n", filename);
         else
         {
-            while (len = fread(buffer, 1, 1024, file))
+            while ((len = fread(buffer, 1, 1024, file)) != 0)
                 Update(buffer, len);
             Final();
 
@@ -9,7 +9,7 @@ namespace cfg
 	ADD_CFG_ITEM(int, testInt, 0, Section1);
 	ADD_CFG_ITEM(float, testFloat, 1.0f, Section1);
 	ADD_CFG_ITEM(bool, testBool, true, Section1);
-	ADD_CFG_ITEM(AmiKeyBind, TestKey, AmiKeyBind(VK_MBUTTON), Section1);
+	ADD_CFG_ITEM(AmiKeyBind, TestKey, AmiKeyBind(input::vk::MBUTTON), Section1);
 	ADD_CFG_ITEM(shared::col_t,color1,shared::col_t(255,0,0,255),Section2)
 	ADD_CFG_ITEM(shared::col_t,  color2, shared::col_t(255,0,0,255), Section2)
 
@@ -0,0 +1,258 @@
+#include "binary.h"
+#include "config.h"
+#include "stats.h"
+#include <cstring>
+
+namespace config::binary
+{
+	namespace
+	{
+		constexpr char MAGIC[4] = { 'S', 'I', 'C', 'B' };
+		constexpr uint32_t VERSION = 1;
+
+		enum record_kind : uint32_t
+		{
+			KIND_BINARY = 0, // payload is the codec's binary form
+			KIND_TEXT = 1, // payload is the ini text of the value
+		};
+
+		struct header_t
+		{
+			char magic[4];
+			uint32_t version;
+			uint64_t source_size; // size of the ini the snapshot was made from
+			int64_t source_mtime; // last write time of that ini
+			hash_t source_hash; // FNV-1a of that ini's content
+			uint32_t record_count;
+			uint32_t strings_size; // bytes of string table following the records
+			uint32_t reserved;
+		};
+
+		struct record_t
+		{
+			hash_t type; // type hash of the item, 0 for converted text records
+			uint32_t kind;
+			uint32_t section; // offsets and sizes in the string table
+			uint32_t section_size;
+			uint32_t name;
+			uint32_t name_size;
+			uint32_t value;
+			uint32_t value_size;
+		};
+
+		static_assert(sizeof(header_t) == 40 && sizeof(record_t) == 32, "snapshot layout must not depend on padding");
+
+		/// <summary>
+		/// Fills the source fields of the header from the ini file on disk
+		/// </summary>
+		bool read_source(const std::string& ini, header_t& header)
+		{
+			std::error_code err;
+			const auto mtime = std::filesystem::last_write_time(ini, err);
+			if (err)
+				return false;
+
+			ini::MappedFile source(ini);
+			if (!source.is_open())
+				return false;
+
+			header.source_size = source.view().size();
+			header.source_mtime = static_cast<int64_t>(mtime.time_since_epoch().count());
+			header.source_hash = shared::hash::get(source.view());
+			return true;
+		}
+
+		class builder_t
+		{
+		public:
+			void add(const std::string_view section, const std::string_view name, const hash_t type, const uint32_t kind, const std::string_view payload)
+			{
+				auto [it, inserted] = m_sections.try_emplace(section, 0u);
+				if (inserted)
+					it->second = add_string(section);
+
+				record_t record{};
+				record.type = type;
+				record.kind = kind;
+				record.section = it->second;
+				record.section_size = static_cast<uint32_t>(section.size());
+				record.name = add_string(name);
+				record.name_size = static_cast<uint32_t>(name.size());
+				record.value = add_string(payload);
+				record.value_size = static_cast<uint32_t>(payload.size());
+				m_records.push_back(record);
+			}
+
+			std::string finish(header_t header) const
+			{
+				std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+				header.version = VERSION;
+				header.record_count = static_cast<uint32_t>(m_records.size());
+				header.strings_size = static_cast<uint32_t>(m_strings.size());
+				header.reserved = 0;
+
+				std::string out;
+				out.reserve(sizeof(header_t) + m_records.size() * sizeof(record_t) + m_strings.size());
+				out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+				out.append(reinterpret_cast<const char*>(m_records.data()), m_records.size() * sizeof(record_t));
+				out += m_strings;
+				return out;
+			}
+
+		private:
+			uint32_t add_string(const std::string_view str)
+			{
+				const auto offset = static_cast<uint32_t>(m_strings.size());
+				m_strings.append(str);
+				return offset;
+			}
+
+			std::vector<record_t> m_records;
+			std::string m_strings;
+			std::unordered_map<std::string_view, uint32_t> m_sections; // section names are stored once
+		};
+	}
+
+	std::string snapshot_path(const std::string& ini)
+	{
+		return ini + ".bin";
+	}
+
+	bool write(const std::string& ini, const std::string& file, const uint32_t flags)
+	{
+		header_t header{};
+		if (!read_source(ini, header))
+			return false;
+
+		builder_t builder;
+		std::string payload;
+		for (const auto& item : get_items())
+		{
+			const auto* codec = find_codec(item.m_type);
+			if (!codec)
+				continue;
+
+			payload.clear();
+			uint32_t kind = KIND_BINARY;
+			if (codec->encode)
+				codec->encode(item.m_var, payload);
+			else
+			{
+				codec->format(item.m_var, payload);
+				kind = KIND_TEXT;
+			}
+			builder.add(item.m_section, item.m_name, item.m_type, kind, payload);
+		}
+
+		return ini::WriteFileAtomic(file, builder.finish(header), flags | ini::WRITE_BINARY);
+	}
+
+	bool convert(const std::string& ini, const std::string& file, const uint32_t flags)
+	{
+		header_t header{};
+		if (!read_source(ini, header))
+			return false;
+
+		ini::MappedFile source(ini);
+		if (!source.is_open())
+			return false;
+
+		builder_t builder;
+		ini::INIParser::parse_view(source.view(), [&builder](std::string_view section, std::string_view key, std::string_view value) {
+			builder.add(section, key, 0, KIND_TEXT, value);
+		});
+
+		return ini::WriteFileAtomic(file, builder.finish(header), flags | ini::WRITE_BINARY);
+	}
+
+	bool load(const std::string& ini, const std::string& file)
+	{
+		ini::MappedFile snapshot(file);
+		if (!snapshot.is_open())
+			return false;
+
+		const std::string_view data = snapshot.view();
+		header_t header;
+		if (data.size() < sizeof(header))
+			return false;
+		std::memcpy(&header, data.data(), sizeof(header));
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+			return false;
+
+		const uint64_t records_size = uint64_t(header.record_count) * sizeof(record_t);
+		if (sizeof(header) + records_size + header.strings_size != data.size())
+			return false;
+
+		// stale check, size and mtime first so a fresh snapshot never touches the ini
+		std::error_code err;
+		const auto size = std::filesystem::file_size(ini, err);
+		if (err || size != header.source_size)
+			return false;
+		const auto mtime = std::filesystem::last_write_time(ini, err);
+		if (err)
+			return false;
+		if (static_cast<int64_t>(mtime.time_since_epoch().count()) != header.source_mtime)
+		{
+			// touched or copied, the content may still be the same
+			ini::MappedFile source(ini);
+			if (!source.is_open() || shared::hash::get(source.view()) != header.source_hash)
+				return false;
+		}
+
+		stats::add(stats::BYTES_READ, data.size());
+		const char* records = data.data() + sizeof(header);
+		const std::string_view strings = data.substr(sizeof(header) + static_cast<size_t>(records_size));
+		const auto get_string = [&strings](const uint32_t offset, const uint32_t size, std::string_view& out) {
+			if (offset > strings.size() || size > strings.size() - offset)
+				return false;
+			out = strings.substr(offset, size);
+			return true;
+		};
+
+		// bounds are checked for every record up front, a corrupt snapshot is rejected before any item changes
+		std::string_view section, name, payload;
+		for (uint32_t i = 0; i < header.record_count; ++i)
+		{
+			record_t record;
+			std::memcpy(&record, records + i * sizeof(record_t), sizeof(record));
+			if (!get_string(record.section, record.section_size, section) ||
+				!get_string(record.name, record.name_size, name) ||
+				!get_string(record.value, record.value_size, payload))
+				return false;
+		}
+
+		value_t scratch;
+		for (uint32_t i = 0; i < header.record_count; ++i)
+		{
+			record_t record;
+			std::memcpy(&record, records + i * sizeof(record_t), sizeof(record));
+			get_string(record.section, record.section_size, section);
+			get_string(record.name, record.name_size, name);
+			get_string(record.value, record.value_size, payload);
+
+			const int index = does_item_exist(section, name);
+			if (index < 0)
+				continue;
+
+			auto& item = get_item(index);
+			const auto* codec = find_codec(item.m_type);
+			if (!codec)
+				continue;
+
+			bool applied = false;
+			if (record.kind == KIND_TEXT)
+				applied = convert_checked(codec->parse, payload, item.m_var, scratch);
+			else if (record.kind == KIND_BINARY && record.type == item.m_type && codec->decode)
+				applied = convert_checked(codec->decode, payload, item.m_var, scratch);
+
+			if (applied)
+			{
+				stats::add(stats::ITEMS_PARSED);
+				item.mark_clean(item.m_generation);
+			}
+			else
+				stats::add(stats::PARSE_ERRORS);
+		}
+		return true;
+	}
+}
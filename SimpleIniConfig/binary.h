@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Binary snapshots of a config. A snapshot sits next to its ini as <config>.bin and holds one
+// fixed-width, type-tagged record per item plus a string table with names and payloads, so it can
+// be applied without tokenizing or converting text. It remembers the size, last write time and
+// hash of the ini it was made from and is ignored once the ini changes.
+namespace config::binary
+{
+	/// <summary>
+	/// Path of the snapshot that belongs to an ini file
+	/// </summary>
+	/// <param name="ini">Path of the ini file</param>
+	/// <returns>Path of the snapshot</returns>
+	std::string snapshot_path(const std::string& ini);
+
+	/// <summary>
+	/// Writes a snapshot of the current item values, which have to match the content of ini
+	/// </summary>
+	/// <param name="ini">Ini file the values were just saved to</param>
+	/// <param name="file">Snapshot file to write</param>
+	/// <param name="flags">ini::WriteFlags used to write the snapshot</param>
+	/// <returns>Was the snapshot written</returns>
+	bool write(const std::string& ini, const std::string& file, const uint32_t flags = 0);
+
+	/// <summary>
+	/// Converts an ini file into a snapshot without going through the registered items, every key
+	/// is kept in its text form
+	/// </summary>
+	/// <param name="ini">Ini file to convert</param>
+	/// <param name="file">Snapshot file to write</param>
+	/// <param name="flags">ini::WriteFlags used to write the snapshot</param>
+	/// <returns>Was the snapshot written</returns>
+	bool convert(const std::string& ini, const std::string& file, const uint32_t flags = 0);
+
+	/// <summary>
+	/// Applies a snapshot to the registered items if it is still fresh for ini
+	/// </summary>
+	/// <param name="ini">Ini file the snapshot was made from</param>
+	/// <param name="file">Snapshot file to apply</param>
+	/// <returns>Was the snapshot applied, false means the ini has to be loaded instead</returns>
+	bool load(const std::string& ini, const std::string& file);
+}
@@ -0,0 +1,217 @@
+#include "config.h"
+#include "numconv.h"
+#include <cstring>
+
+namespace config
+{
+	namespace
+	{
+		// Binary snapshot form of trivially copyable values, native byte order
+		template< typename t >
+		bool decode_raw(std::string_view bytes, t& out)
+		{
+			if (bytes.size() != sizeof(t))
+				return false;
+			std::memcpy(&out, bytes.data(), sizeof(t));
+			return true;
+		}
+
+		template< typename t >
+		void encode_raw(std::string& out, const t& val)
+		{
+			out.append(reinterpret_cast<const char*>(&val), sizeof(t));
+		}
+
+		template< typename t >
+		codec_t number_codec()
+		{
+			return codec_t{
+				[](std::string_view text, value_t& out) {
+					t val;
+					if (!shared::num::parse(text, val))
+						return false;
+					value_ensure<t>(out) = val;
+					return true;
+				},
+				[](const value_t& in, std::string& out) { shared::num::append(out, *value_ptr<t>(in)); },
+				[](std::string_view bytes, value_t& out) {
+					t val;
+					if (!decode_raw(bytes, val))
+						return false;
+					value_ensure<t>(out) = val;
+					return true;
+				},
+				[](const value_t& in, std::string& out) { encode_raw(out, *value_ptr<t>(in)); }
+			};
+		}
+
+		template< typename t >
+		codec_t number_vector_codec()
+		{
+			return codec_t{
+				[](std::string_view text, value_t& out) {
+					// parsed aside and swapped in, so malformed text leaves the vector as it was. The
+					// swap hands the old buffer to the scratch vector, which keeps reusing it.
+					thread_local std::vector<t> parsed;
+					parsed.clear();
+					const bool valid = shared::num::parse_list<t>(text, [](const t val) {
+						parsed.push_back(val);
+						return true;
+					});
+					if (!valid)
+						return false;
+
+					value_ensure<std::vector<t>>(out).swap(parsed);
+					return true;
+				},
+				[](const value_t& in, std::string& out) {
+					const auto& vec = *value_ptr<std::vector<t>>(in);
+					for (size_t i = 0; i < vec.size(); ++i)
+					{
+						if (i != 0)
+							out += ',';
+						shared::num::append(out, vec[i]);
+					}
+				},
+				[](std::string_view bytes, value_t& out) {
+					if (bytes.size() % sizeof(t) != 0)
+						return false;
+					auto& vec = value_ensure<std::vector<t>>(out);
+					vec.resize(bytes.size() / sizeof(t));
+					if (!vec.empty())
+						std::memcpy(vec.data(), bytes.data(), bytes.size());
+					return true;
+				},
+				[](const value_t& in, std::string& out) {
+					const auto& vec = *value_ptr<std::vector<t>>(in);
+					out.append(reinterpret_cast<const char*>(vec.data()), vec.size() * sizeof(t));
+				}
+			};
+		}
+
+		bool parse_bool(std::string_view text, bool& out)
+		{
+			if (text == "true" || text == "True" || text == "TRUE" || text == "1")
+				out = true;
+			else if (text == "false" || text == "False" || text == "FALSE" || text == "0")
+				out = false;
+			else
+				return false;
+			return true;
+		}
+
+		std::unordered_map<hash_t, codec_t> builtin_codecs()
+		{
+			std::unordered_map<hash_t, codec_t> codecs;
+
+			codecs.emplace(CT_HASH("bool"), codec_t{
+				[](std::string_view text, value_t& out) {
+					bool val;
+					if (!parse_bool(text, val))
+						return false;
+					value_ensure<bool>(out) = val;
+					return true;
+				},
+				[](const value_t& in, std::string& out) { out += *value_ptr<bool>(in) ? "true" : "false"; },
+				[](std::string_view bytes, value_t& out) {
+					uint8_t val;
+					if (!decode_raw(bytes, val))
+						return false;
+					value_ensure<bool>(out) = val != 0;
+					return true;
+				},
+				[](const value_t& in, std::string& out) { encode_raw(out, uint8_t(*value_ptr<bool>(in) ? 1 : 0)); }
+			});
+
+			codecs.emplace(CT_HASH("int"), number_codec<int>());
+			codecs.emplace(CT_HASH("float"), number_codec<float>());
+
+			codecs.emplace(CT_HASH("shared::col_t"), codec_t{
+				[](std::string_view text, value_t& out) {
+					shared::col_t col;
+					if (!shared::num::parse_color(text, col))
+						return false;
+					value_ensure<shared::col_t>(out) = col;
+					return true;
+				},
+				[](const value_t& in, std::string& out) { shared::num::append_color(out, *value_ptr<shared::col_t>(in)); },
+				[](std::string_view bytes, value_t& out) {
+					std::array<uint8_t, 4> components;
+					if (!decode_raw(bytes, components))
+						return false;
+					value_ensure<shared::col_t>(out).m_color = components;
+					return true;
+				},
+				[](const value_t& in, std::string& out) { encode_raw(out, value_ptr<shared::col_t>(in)->m_color); }
+			});
+
+			codecs.emplace(CT_HASH("std::string"), codec_t{
+				[](std::string_view text, value_t& out) {
+					value_ensure<std::string>(out).assign(text);
+					return true;
+				},
+				[](const value_t& in, std::string& out) { out += *value_ptr<std::string>(in); },
+				[](std::string_view bytes, value_t& out) {
+					value_ensure<std::string>(out).assign(bytes);
+					return true;
+				},
+				[](const value_t& in, std::string& out) { out += *value_ptr<std::string>(in); }
+			});
+
+			codecs.emplace(CT_HASH("std::vector<int>"), number_vector_codec<int>());
+			codecs.emplace(CT_HASH("std::vector<float>"), number_vector_codec<float>());
+
+			codecs.emplace(CT_HASH("AmiKeyBind"), codec_t{
+				[](std::string_view text, value_t& out) {
+					int key;
+					if (!shared::num::parse(text, key))
+						return false;
+					value_ensure<AmiKeyBind>(out) = AmiKeyBind(key);
+					return true;
+				},
+				[](const value_t& in, std::string& out) { shared::num::append(out, value_ptr<AmiKeyBind>(in)->Get()); },
+				[](std::string_view bytes, value_t& out) {
+					int key;
+					if (!decode_raw(bytes, key))
+						return false;
+					value_ensure<AmiKeyBind>(out) = AmiKeyBind(key);
+					return true;
+				},
+				[](const value_t& in, std::string& out) { encode_raw(out, value_ptr<AmiKeyBind>(in)->Get()); }
+			});
+
+			return codecs;
+		}
+
+		std::unordered_map<hash_t, codec_t>& get_codecs()
+		{
+			static std::unordered_map<hash_t, codec_t> codecs = builtin_codecs();
+			return codecs;
+		}
+	}
+
+	bool convert_checked(bool (*convert)(std::string_view, value_t&), const std::string_view text, value_t& target, value_t& scratch)
+	{
+		scratch = target; // same alternative, so convert assigns into it instead of switching type
+		if (!convert(text, scratch))
+			return false;
+
+		if (std::holds_alternative<std::any>(target))
+			return convert(text, target);
+
+		target.swap(scratch); // swaps the alternatives in place, the address of the value does not change
+		return true;
+	}
+
+	void register_codec(const hash_t type, const codec_t codec)
+	{
+		get_codecs()[type] = codec;
+	}
+
+	const codec_t* find_codec(const hash_t type)
+	{
+		const auto& codecs = get_codecs();
+		const auto it = codecs.find(type);
+		return it != codecs.end() ? &it->second : nullptr;
+	}
+}
@@ -7,6 +7,7 @@ namespace shared
 		std::array<uint8_t, 4> m_color;
 
 		col_t() = default;
+		col_t(const col_t&) = default;
 
 		col_t(const int r, const int g, const int b) : m_color({ 0,0,0,0 })
 		{
@@ -74,7 +75,7 @@ namespace shared
 
 		inline bool operator==(const col_t& in) const
 		{
-			return *const_cast<col_t*>(this) == *const_cast<col_t*>(&in);
+			return m_color == in.m_color;
 		}
 
 		inline bool operator!=(const col_t& in) const
@@ -1,14 +1,21 @@
 #include "config.h"
 #include "MD5.h"
-#include <type_traits> // issame
-#define DEBUGLOG
-
+#include "binary.h"
+#include "log.h"
+#include "observer.h"
+#include "snapshot.h"
+#include "stats.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
 namespace config
 {
 	std::string m_name = "cfg";
-	std::vector<item_t>& get_items()
+	std::mutex m_name_mutex; // the directory may be read from any thread
+	items_t& get_items()
 	{
-		static std::vector<item_t> items;
+		static items_t items;
 		return items;
 	}
 
@@ -17,264 +24,610 @@ namespace config
 		return get_items().at(index);
 	}
 
-	int does_item_exist(const std::string& section, const std::string& key) {
-		for (size_t i = 0; i < get_items().size(); i++) {
-			auto caseInsensitiveCompare = [](const std::string& str1, const std::string& str2) {
-				return std::equal(str1.begin(), str1.end(),
-					str2.begin(), str2.end(),
-					[](char c1, char c2) {
-						return std::tolower(c1) == std::tolower(c2);
-					});
-			};
+	namespace
+	{
+		std::unordered_multimap<hash_t, uint32_t>& get_item_index()
+		{
+			static std::unordered_multimap<hash_t, uint32_t> index(CONFIG_RESERVED_ITEMS);
+			return index;
+		}
+
+		// (section, name, type) -> index, guards against registering the same item twice
+		std::unordered_multimap<hash_t, uint32_t>& get_registered_items()
+		{
+			static std::unordered_multimap<hash_t, uint32_t> registered(CONFIG_RESERVED_ITEMS);
+			return registered;
+		}
+
+		hash_t registration_key(const item_t& item)
+		{
+			const hash_t seed = (shared::hash::get(item.m_section) ^ hash_t('.')) * shared::hash::PRIME;
+			return (shared::hash::get(item.m_name, seed) ^ item.m_type) * shared::hash::PRIME;
+		}
+
+		hash_t item_key(const std::string_view section, const std::string_view key)
+		{
+			// separator keeps "ab"+"c" and "a"+"bc" apart
+			const hash_t seed = (shared::hash::get_folded(section) ^ hash_t('.')) * shared::hash::PRIME;
+			return shared::hash::get_folded(key, seed);
+		}
+
+		bool equals_folded(const std::string_view str1, const std::string_view str2)
+		{
+			return std::equal(str1.begin(), str1.end(), str2.begin(), str2.end(),
+				[](char c1, char c2) {
+					return shared::hash::fold(c1) == shared::hash::fold(c2);
+				});
+		}
+	}
+
+	uint32_t register_item(item_t&& item)
+	{
+		auto& items = get_items();
+		const hash_t key = registration_key(item);
+
+		auto [begin, end] = get_registered_items().equal_range(key);
+		for (auto it = begin; it != end; ++it) { // fix in case of multi init
+			const auto& existing = items[it->second];
+			if (existing.m_name == item.m_name && existing.m_type == item.m_type && existing.m_section == item.m_section) {
+				// Item already exists, return its index
+				return it->second;
+			}
+		}
 
-			if (caseInsensitiveCompare(get_items()[i].m_section, section) &&
-				caseInsensitiveCompare(get_items()[i].m_name, key)) {
-				return i;
+		const auto index = static_cast<uint32_t>(items.size());
+		item.m_observed = is_section_observed(item.m_section);
+		get_registered_items().emplace(key, index);
+		get_item_index().emplace(item_key(item.m_section, item.m_name), index);
+		items.push_back(std::move(item));
+		return index;
+	}
+
+	int does_item_exist(const std::string_view section, const std::string_view key) {
+		stats::add(stats::LOOKUPS);
+		int found = -1;
+		auto [begin, end] = get_item_index().equal_range(item_key(section, key));
+		for (auto it = begin; it != end; ++it) {
+			const auto& item = get_items()[it->second];
+			// hash collisions are possible, so confirm the match and keep the first registered item
+			if ((found < 0 || static_cast<int>(it->second) < found) &&
+				equals_folded(item.m_section, section) && equals_folded(item.m_name, key)) {
+				found = static_cast<int>(it->second);
 			}
 		}
-		return -1; // Not found
+		return found; // -1 if not found
 	}
 
 
 
-	void save(const std::string_view config)
+	namespace
 	{
-		std::filesystem::path config_path = std::filesystem::path(m_name) / config;
-		std::filesystem::create_directory(config_path.parent_path());
-		std::ofstream myfile;
-		myfile.open("savelog.txt", std::ios_base::app);
-		myfile << "filepath  " << config_path << std::endl;
+		// Path of the config file the dirty state of the items refers to
+		std::string synced_config;
+		std::filesystem::file_time_type synced_write_time; // of synced_config when it was last read or written
 
+		void set_synced(const std::string& path)
+		{
+			std::error_code err;
+			synced_config = path;
+			synced_write_time = std::filesystem::last_write_time(path, err);
+		}
+
+		// Item index and the generation of its value that is being written
+		using written_items_t = std::vector<std::pair<uint32_t, uint32_t>>;
 
-		for (auto& item : get_items())
+		void mark_all_dirty()
 		{
+			for (auto& item : get_items())
+				item.mark_dirty();
+		}
 
-			std::string section = item.m_section;
-			std::string key = item.m_name;
-			myfile << "item name  " << key << " item section  " << section << " item type  " << item.m_type << std::endl;
-			switch (item.m_type)
-			{
-			case CT_HASH("bool"):
-				ini::Write(section, key, item.get<bool>(), config_path.string());
-				break;
+		bool values_equal(const codec_t& codec, const value_t& lhs, const value_t& rhs)
+		{
+			if (lhs.index() != rhs.index())
+				return false;
+
+			return std::visit([&](const auto& val) {
+				using val_t = std::decay_t<decltype(val)>;
+				if constexpr (requires { val == val; })
+					return val == std::get<val_t>(rhs);
+				else
+				{
+					// std::any and types without operator== compare by their text form
+					std::string lhs_text, rhs_text;
+					codec.format(lhs, lhs_text);
+					codec.format(rhs, rhs_text);
+					return lhs_text == rhs_text;
+				}
+			}, lhs);
+		}
 
-			case CT_HASH("float"):
-				ini::Write(section, key, item.get<float>(), config_path.string());
-				break;
+		// Values of the observed items before a load, compared afterwards to find the changed ones
+		using observed_values_t = std::vector<std::pair<uint32_t, value_t>>;
 
-			case CT_HASH("int"):
-				ini::Write(section, key, item.get<int>(), config_path.string());
-				break;
+		observed_values_t save_observed()
+		{
+			observed_values_t values;
+			auto& items = get_items();
+			for (uint32_t i = 0; i < items.size(); ++i)
+			{
+				if (items[i].m_observed)
+					values.emplace_back(i, items[i].m_var);
+			}
+			return values;
+		}
 
-			case CT_HASH("shared::col_t"):
+		void notify_observed(const observed_values_t& values)
+		{
+			std::vector<uint32_t> changed;
+			for (const auto& [index, value] : values)
 			{
-				ini::Write(section, key, item.get<shared::col_t>(), config_path.string());
-				break;
+				const auto& item = get_items()[index];
+				const auto* codec = find_codec(item.m_type);
+				if (codec && !values_equal(*codec, value, item.m_var))
+					changed.push_back(index);
 			}
-			case CT_HASH("std::string"):
-				ini::Write_internal(section, key, item.get<std::string>(), config_path.string());
-				break;
-
-			case CT_HASH("std::vector<int>"):
-				ini::Write(section, key, item.get<std::vector<int>>(), config_path.string());
-				break;
-
-			case CT_HASH("std::vector<float>"):
-				ini::Write(section, key, item.get<std::vector<float>>(), config_path.string());
-				break;
-			case CT_HASH("AmiKeyBind"):
-				ini::Write(section, key, item.get<AmiKeyBind>(), config_path.string());
-				break;
-			default:
-				myfile << "Unknown item type for key: " << key << std::endl;
-				break;
+			notify(changed);
+		}
+
+		void collect_entries(const bool dirty_only, std::vector<ini::Entry>& entries, written_items_t& written_items)
+		{
+			auto& items = get_items();
+			entries.reserve(dirty_only ? 16 : items.size());
+			written_items.reserve(entries.capacity());
+
+			for (uint32_t i = 0; i < items.size(); ++i)
+			{
+				auto& item = items[i];
+				if (dirty_only && !item.is_dirty())
+					continue;
+
+				const auto* codec = find_codec(item.m_type);
+				if (!codec)
+				{
+					CONFIG_LOG(warning, "Unknown item type for key: ", item.m_name);
+					continue;
+				}
+
+				std::string value;
+				codec->format(item.m_var, value);
+				CONFIG_LOG(trace, "Saving ", item.m_section, '.', item.m_name, " = ", value);
+				entries.push_back(ini::Entry{ item.m_section, item.m_name, std::move(value) });
+				written_items.emplace_back(i, item.m_generation);
 			}
 		}
 
+		void mark_written(const std::string& path, const written_items_t& written_items)
+		{
+			auto& items = get_items();
+			for (const auto& [index, generation] : written_items)
+				items[index].mark_clean(generation);
+			set_synced(path);
+		}
 
-		myfile.close();
-	}
+		/// <summary>
+		/// Background thread behind save_async. It only ever touches the captured entries, never
+		/// the items, results are handed back and applied on the items thread.
+		/// </summary>
+		class save_worker_t
+		{
+		public:
+			struct completed_t
+			{
+				std::string path;
+				bool written;
+				written_items_t written_items;
+			};
+
+			save_worker_t()
+				: m_thread(&save_worker_t::run, this)
+			{}
+
+			~save_worker_t()
+			{
+				{
+					std::lock_guard lock(m_mutex);
+					m_stopping = true;
+				}
+				m_wake.notify_all();
+				m_thread.join(); // pending saves are written before the thread exits
+			}
+
+			std::shared_future<bool> queue(const std::string& path, const uint32_t flags, std::vector<ini::Entry>&& entries, written_items_t&& written_items)
+			{
+				std::lock_guard lock(m_mutex);
+				auto job = std::find_if(m_jobs.begin(), m_jobs.end(), [&path](const job_t& pending) { return pending.path == path; });
+				if (job == m_jobs.end())
+				{
+					if (entries.empty())
+					{
+						std::promise<bool> done;
+						done.set_value(true);
+						return done.get_future().share();
+					}
+
+					job = m_jobs.emplace(m_jobs.end());
+					job->path = path;
+					job->future = job->promise.get_future().share();
+					job->due = std::chrono::steady_clock::now() + m_debounce;
+					m_wake.notify_all();
+				}
+
+				job->flags |= flags;
+				for (auto& entry : entries)
+				{
+					auto [it, inserted] = job->entry_index.try_emplace(entry.section + '\n' + entry.key, job->entries.size());
+					if (inserted)
+						job->entries.push_back(std::move(entry));
+					else
+						job->entries[it->second] = std::move(entry); // newer value wins
+				}
+				job->written_items.insert(job->written_items.end(), written_items.begin(), written_items.end());
+				return job->future;
+			}
+
+			bool flush()
+			{
+				std::unique_lock lock(m_mutex);
+				m_flushing = true;
+				m_wake.notify_all();
+				m_idle.wait(lock, [this] { return m_jobs.empty() && !m_writing; });
+				m_flushing = false;
+
+				const bool ok = !m_failed;
+				m_failed = false;
+				return ok;
+			}
+
+			void set_debounce(const std::chrono::milliseconds window)
+			{
+				std::lock_guard lock(m_mutex);
+				m_debounce = window;
+			}
+
+			std::vector<completed_t> take_completed()
+			{
+				std::lock_guard lock(m_mutex);
+				return std::exchange(m_completed, {});
+			}
 
+		private:
+			struct job_t
+			{
+				std::string path;
+				uint32_t flags = 0;
+				std::vector<ini::Entry> entries;
+				std::unordered_map<std::string, size_t> entry_index; // "section\nkey" -> entries index
+				written_items_t written_items;
+				std::promise<bool> promise;
+				std::shared_future<bool> future;
+				std::chrono::steady_clock::time_point due;
+			};
 
+			void run()
+			{
+				std::unique_lock lock(m_mutex);
+				while (true)
+				{
+					m_wake.wait(lock, [this] { return m_stopping || !m_jobs.empty(); });
+					if (m_jobs.empty())
+						return; // stopping with nothing left to write
+
+					// collect more requests until the window of the oldest one closes
+					const auto due = m_jobs.front().due;
+					m_wake.wait_until(lock, due, [this] { return m_stopping || m_flushing; });
+
+					job_t job = std::move(m_jobs.front());
+					m_jobs.pop_front();
+					m_writing = true;
+					lock.unlock();
+
+					bool written;
+					{
+						stats::timer_t timer(stats::PHASE_WRITE);
+						written = ini::WriteBatch(job.entries, job.path, job.flags & ~SAVE_SNAPSHOT);
+					}
+					job.promise.set_value(written);
+
+					lock.lock();
+					m_writing = false;
+					m_failed = m_failed || !written;
+					m_completed.push_back(completed_t{ std::move(job.path), written, std::move(job.written_items) });
+					if (m_jobs.empty())
+						m_idle.notify_all();
+				}
+			}
 
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+			std::condition_variable m_idle;
+			std::deque<job_t> m_jobs; // at most one pending job per config file
+			std::vector<completed_t> m_completed;
+			std::chrono::milliseconds m_debounce{ 250 };
+			bool m_stopping = false;
+			bool m_flushing = false;
+			bool m_writing = false;
+			bool m_failed = false;
+			std::thread m_thread; // last so every member above exists before the thread starts
+		};
+
+		std::unique_ptr<save_worker_t> save_worker;
+		std::chrono::milliseconds save_debounce{ 250 };
+
+		/// <summary>
+		/// Marks the items of finished async saves clean, runs on the items thread
+		/// </summary>
+		void apply_completed_saves()
+		{
+			if (!save_worker)
+				return;
 
-	// This is a generic helper function to split a string into a vector
-	template <typename T>
-	std::vector<T> splitToVector(const std::string& s, char delimiter) {
-		std::vector<T> elems;
-		std::stringstream ss(s);
-		std::string item;
-		while (std::getline(ss, item, delimiter)) {
-			if constexpr (std::is_same_v<T, int>) {
-				elems.push_back(std::stoi(item));
+			for (const auto& completed : save_worker->take_completed())
+			{
+				if (completed.written)
+					mark_written(completed.path, completed.written_items);
 			}
-			else if constexpr (std::is_same_v<T, float>) {
-				elems.push_back(std::stof(item));
+		}
+
+		bool write_items(const std::filesystem::path& config_path, const uint32_t flags, const bool dirty_only)
+		{
+			CONFIG_LOG(info, "Saving config to ", config_path);
+
+			stats::timer_t timer(stats::PHASE_CONVERT);
+			std::vector<ini::Entry> entries;
+			written_items_t written_items;
+			collect_entries(dirty_only, entries, written_items);
+
+			if (dirty_only && entries.empty())
+			{
+				CONFIG_LOG(debug, "Nothing changed in ", config_path);
+				return true;
 			}
-			else {
-				elems.push_back(item);
+
+			timer.switch_to(stats::PHASE_WRITE);
+			const bool written = ini::WriteBatch(entries, config_path.string(), flags);
+			if (!written)
+				CONFIG_LOG(error, "Failed to write ", config_path);
+			else
+			{
+				mark_written(config_path.string(), written_items);
+
+				if ((flags & SAVE_SNAPSHOT) && !binary::write(config_path.string(), binary::snapshot_path(config_path.string()), flags))
+					CONFIG_LOG(error, "Failed to write snapshot of ", config_path);
 			}
+
+			return written;
 		}
-		return elems;
 	}
 
-	bool load_settings(const std::string_view config) {
-		std::filesystem::path config_path = std::filesystem::path(m_name) / config;
+	std::shared_future<bool> save_async(const std::string_view config, const uint32_t flags)
+	{
+		if (!save_worker)
+		{
+			save_worker = std::make_unique<save_worker_t>();
+			save_worker->set_debounce(save_debounce);
+		}
+		apply_completed_saves();
+
+		std::filesystem::path config_path = std::filesystem::path(get_config_directory()) / config;
+		std::error_code err;
+		std::filesystem::create_directory(config_path.parent_path(), err);
+		const bool dirty_only = synced_config == config_path.string() && std::filesystem::exists(config_path, err);
+
+		std::vector<ini::Entry> entries;
+		written_items_t written_items;
+		collect_entries(dirty_only, entries, written_items);
+		return save_worker->queue(config_path.string(), flags, std::move(entries), std::move(written_items));
+	}
+
+	bool flush()
+	{
+		if (!save_worker)
+			return true;
+
+		const bool ok = save_worker->flush();
+		apply_completed_saves();
+		return ok;
+	}
+
+	void set_save_debounce(const std::chrono::milliseconds window)
+	{
+		save_debounce = window;
+		if (save_worker)
+			save_worker->set_debounce(window);
+	}
+
+	bool save(const std::string_view config, const uint32_t flags)
+	{
+		flush(); // a queued async save must not land on top of this one
+		std::filesystem::path config_path = std::filesystem::path(get_config_directory()) / config;
+		std::filesystem::create_directory(config_path.parent_path());
+		return write_items(config_path, flags, false);
+	}
+
+	bool save_changes(const std::string_view config, const uint32_t flags)
+	{
+		flush();
+		std::filesystem::path config_path = std::filesystem::path(get_config_directory()) / config;
+		std::error_code err;
+		if (synced_config != config_path.string() || !std::filesystem::exists(config_path, err))
+			return save(config, flags);
+
+		return write_items(config_path, flags, true);
+	}
+
+
 
-#ifdef DEBUGLOG
-		std::ofstream logFile;
-		logFile.open("loadlog.txt", std::ios_base::app);
-		logFile << "Loading config from: " << config_path << std::endl;
-#endif
+
+	bool load_settings(const std::string_view config) {
+		flush(); // queued async saves hold values from before this load
+		std::filesystem::path config_path = std::filesystem::path(get_config_directory()) / config;
+		CONFIG_LOG(info, "Loading config from ", config_path);
 
 		std::error_code err(0, std::generic_category());
 		std::filesystem::create_directory(config_path.parent_path(), err);
 		if (err.value() != 0) {
-#ifdef DEBUGLOG
-			logFile << "Error creating directory. Error code: " << err.value() << std::endl;
-#endif
+			CONFIG_LOG(error, "Error creating directory. Error code: ", err.value());
 			return false;
 		}
 
 		if (!std::filesystem::is_regular_file(config_path)) {
-#ifdef DEBUGLOG
-			logFile << "Config path is not a regular file." << std::endl;
-#endif
+			CONFIG_LOG(error, "Config path is not a regular file: ", config_path);
 			return false;
 		}
 
 		if (!std::filesystem::exists(config_path)) {
-#ifdef DEBUGLOG
-			logFile << "Config file doesn't exist." << std::endl;
-#endif
+			CONFIG_LOG(error, "Config file doesn't exist: ", config_path);
 			return false;
 		}
 
-		ini::INIParser parser;
-		std::ifstream config_file(config_path, std::ios::in);
+		// items missing from the file stay dirty so the next save_changes writes them
+		mark_all_dirty();
+		const auto observed = save_observed();
+		stats::timer_t timer(stats::PHASE_READ);
+		if (binary::load(config_path.string(), binary::snapshot_path(config_path.string()))) {
+			stats::add(stats::CACHE_HITS);
+			timer.switch_to(stats::PHASE_APPLY);
+			set_synced(config_path.string());
+			publish();
+			notify_observed(observed);
+			CONFIG_LOG(info, "Loaded snapshot of ", config_path);
+			return true;
+		}
+
+		ini::MappedFile config_file(config_path.string());
 		if (!config_file.is_open()) {
-#ifdef DEBUGLOG
-			logFile << "Error opening the config file." << std::endl;
-#endif
+			CONFIG_LOG(error, "Error opening the config file ", config_path);
 			return false;
 		}
 
-		std::string content((std::istreambuf_iterator<char>(config_file)),
-			std::istreambuf_iterator<char>());
-
-		parser.parse(content, false);
-#ifdef DEBUGLOG
-		logFile << "file content " << content << std::endl;
-#endif
-
-		for (const auto& [sectionName, section] : parser.sections) {
-			for (const auto& [key, value] : section) {
-				auto item_index = does_item_exist(sectionName, key);
-				if (item_index < 0) {
-#ifdef DEBUGLOG
-					logFile << "Key not found in items: " << key << std::endl;
-#endif
-					continue;
-				}
-				auto& cur_item = get_items().at(item_index);
-#ifdef DEBUGLOG
-				logFile << "Setting key: " << key << " with item type: " << cur_item.m_type << " and item index " << item_index << std::endl;
-#endif
-
-				switch (cur_item.m_type) {
-				case CT_HASH("bool"):
-					cur_item.set<bool>(value == "true");
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": " << (value == "true") << std::endl;
-#endif
-					break;
-
-				case CT_HASH("float"):
-					cur_item.set<float>(std::stof(value));
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": " << std::stof(value) << std::endl;
-#endif
-					break;
-
-				case CT_HASH("int"):
-					cur_item.set<int>(std::stoi(value));
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": " << std::stoi(value) << std::endl;
-#endif
-					break;
-
-				case CT_HASH("shared::col_t"):
-				{
-					std::stringstream ss(value);
-					std::vector<std::string> values;
-					std::string temp;
-					while (getline(ss, temp, ',')) {
-						values.push_back(temp);
-					}
+		const std::string_view content = config_file.view();
+		stats::add(stats::BYTES_READ, content.size());
+		value_t scratch;
 
-					auto colVal = shared::col_t(std::stoi(values[0]), std::stoi(values[1]), std::stoi(values[2]), std::stoi(values[3]));
-					cur_item.set<shared::col_t>(colVal);
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": RGB(" << std::stoi(values[0]) << ", " << std::stoi(values[1]) << ", " << std::stoi(values[2]) << ")" << std::endl;
-#endif
-					break;
-				}
+		const auto apply_value = [&](std::string_view sectionName, std::string_view key, std::string_view value) {
+			auto item_index = does_item_exist(sectionName, key);
+			if (item_index < 0) {
+				stats::add(stats::UNKNOWN_KEYS);
+				CONFIG_LOG(debug, "Key not found in items: ", sectionName, '.', key);
+				return;
+			}
+			auto& cur_item = get_items().at(item_index);
+
+			timer.switch_to(stats::PHASE_CONVERT);
+			const auto* codec = find_codec(cur_item.m_type);
+			if (!codec) {
+				stats::add(stats::PARSE_ERRORS);
+				CONFIG_LOG(warning, "Unknown type ", cur_item.m_type, " for key ", key);
+				return;
+			}
 
-				case CT_HASH("std::string"):
-					cur_item.set<std::string>(value);
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": " << value << std::endl;
-#endif
-					break;
+			if (!convert_checked(codec->parse, value, cur_item.m_var, scratch)) {
+				stats::add(stats::PARSE_ERRORS);
+				CONFIG_LOG(warning, "Invalid value for key ", key, ": ", value);
+				return;
+			}
+			stats::add(stats::ITEMS_PARSED);
+			cur_item.mark_clean(cur_item.m_generation);
+			CONFIG_LOG(trace, "Value set for key ", key, " (item ", item_index, "): ", value);
+		};
+
+		timer.switch_to(stats::PHASE_TOKENIZE);
+		ini::INIParser::parse_view(content, [&](std::string_view sectionName, std::string_view key, std::string_view value) {
+			timer.switch_to(stats::PHASE_LOOKUP);
+			apply_value(sectionName, key, value);
+			timer.switch_to(stats::PHASE_TOKENIZE);
+		});
+
+		timer.switch_to(stats::PHASE_APPLY);
+		set_synced(config_path.string());
+		publish();
+		notify_observed(observed);
+		return true;
+	}
 
-				case CT_HASH("std::vector<int>"):
-				{
-					std::vector<int> intVector = splitToVector<int>(value, ',');
-					cur_item.set<std::vector<int>>(intVector);
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": " << value << std::endl;
-#endif
-					break;
-				}
+	size_t reload_settings(const std::string_view config, const std::function<void(uint32_t)>& on_change)
+	{
+		return reload_file(std::filesystem::path(get_config_directory()) / config, on_change);
+	}
 
-				case CT_HASH("std::vector<float>"):
-				{
-					std::vector<float> floatVector = splitToVector<float>(value, ',');
-					cur_item.set<std::vector<float>>(floatVector);
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": " << value << std::endl;
-#endif
-					break;
-				}
+	size_t reload_file(const std::filesystem::path& config_path, const std::function<void(uint32_t)>& on_change)
+	{
+		flush();
+		stats::timer_t timer(stats::PHASE_READ);
+		ini::MappedFile config_file(config_path.string());
+		if (!config_file.is_open())
+			return 0;
+
+		stats::add(stats::BYTES_READ, config_file.view().size());
+		std::vector<uint32_t> changed;
+		value_t candidate;
+		mark_all_dirty(); // as in load_settings, items missing from the file stay dirty
+
+		const auto apply_value = [&](std::string_view sectionName, std::string_view key, std::string_view value) {
+			const int item_index = does_item_exist(sectionName, key);
+			if (item_index < 0) {
+				stats::add(stats::UNKNOWN_KEYS);
+				return;
+			}
 
-				case CT_HASH("AmiKeyBind"):
-					cur_item.set<AmiKeyBind>(AmiKeyBind(std::stoi(value)));
-#ifdef DEBUGLOG
-					logFile << "Value set for key " << key << ": " << std::stoi(value) << std::endl;
-#endif
-					break;
-
-				default:
-#ifdef DEBUGLOG
-					logFile << "Unknown type for key " << key << std::endl;
-#endif
-					break;
-				}
+			timer.switch_to(stats::PHASE_CONVERT);
+			auto& cur_item = get_items().at(item_index);
+			const auto* codec = find_codec(cur_item.m_type);
+			candidate = cur_item.m_var;
+			if (!codec || !codec->parse(value, candidate)) {
+				stats::add(stats::PARSE_ERRORS);
+				return;
+			}
+
+			if (!values_equal(*codec, candidate, cur_item.m_var))
+			{
+				// parsed once more in place so handles into the value stay valid
+				codec->parse(value, cur_item.m_var);
+				cur_item.mark_dirty();
+				changed.push_back(static_cast<uint32_t>(item_index));
+				stats::add(stats::ITEMS_PARSED);
 			}
+			cur_item.mark_clean(cur_item.m_generation);
+		};
+
+		timer.switch_to(stats::PHASE_TOKENIZE);
+		ini::INIParser::parse_view(config_file.view(), [&](std::string_view sectionName, std::string_view key, std::string_view value) {
+			timer.switch_to(stats::PHASE_LOOKUP);
+			apply_value(sectionName, key, value);
+			timer.switch_to(stats::PHASE_TOKENIZE);
+		});
+
+		timer.switch_to(stats::PHASE_APPLY);
+		set_synced(config_path.string());
+
+		if (changed.empty())
+			return 0;
+
+		publish();
+		notify(changed);
+		if (on_change)
+		{
+			for (const uint32_t index : changed)
+				on_change(index);
 		}
-#ifdef DEBUGLOG
-		logFile.close();
-#endif
-		return true;
+		return changed.size();
+	}
+
+	loaded_config_t get_loaded_config()
+	{
+		return loaded_config_t{ synced_config, synced_write_time };
 	}
 
 	void set_config_directory(const std::string name) // relative or absolute path should be passed
 	{
+		std::lock_guard lock(m_name_mutex);
 		m_name = name;
 	}
 
 	std::string get_config_directory()
 	{
+		std::lock_guard lock(m_name_mutex);
 		return m_name;
 	}
 
@@ -1,17 +1,29 @@
 #pragma once
 
+#ifdef _WIN32
+#ifndef NOMINMAX
 #define NOMINMAX
+#endif
 #include <Windows.h>
+#endif
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <deque>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <string_view>
 #include <filesystem>
 #include <any>
+#include "hash.h"
 #include "iniconfig.h"
 #include "color.h"
 #include <variant>
+#include <type_traits>
+#include <chrono>
+#include <future>
+#include <functional>
 #include "kbinds.h"
 
 
@@ -20,91 +32,243 @@
 
 // Your header file content here...
 
-using hash_t = uint32_t;
-namespace shared::hash
+#ifndef CONFIG_RESERVED_ITEMS
+// Lookup table capacity reserved up front so static registration rarely rehashes
+#define CONFIG_RESERVED_ITEMS 1024
+#endif
+
+namespace config
 {
-	constexpr uint64_t BASIS = 0x811c9dc5;
-	constexpr uint64_t PRIME = 0x1000193;
+
+
+
+	/// <summary>
+	/// Value storage of an item, built-in types are held inline and anything else falls back to std::any
+	/// </summary>
+	using value_t = std::variant<bool, int, float, shared::col_t, AmiKeyBind, std::string, std::vector<int>, std::vector<float>, std::any>;
+
+	template< typename t, typename v >
+	struct is_alternative;
+
+	template< typename t, typename... ts >
+	struct is_alternative<t, std::variant<ts...>> : std::disjunction<std::is_same<t, ts>...> {};
 
 	/// <summary>
-	/// Creates hash of text during compile-time
+	/// True for types that value_t stores without going through std::any
 	/// </summary>
-	/// <param name="txt">The text that is going to be hashed</param>
-	/// <param name="value">The current hash value</param>
-	/// <returns>Hashed text</returns>
-	inline constexpr hash_t get_const(const char* txt, const hash_t value = BASIS) noexcept
+	template< typename t >
+	constexpr bool is_builtin_v = is_alternative<t, value_t>::value && !std::is_same_v<t, std::any>;
+
+	/// <summary>
+	/// Wraps a value into the value_t alternative matching its type
+	/// </summary>
+	template< typename t >
+	value_t make_value(const t& val)
 	{
-		/// Recursive hashing
-		return (txt[0] == '\0') ? value :
-			get_const(&txt[1], (value ^ hash_t(txt[0])) * PRIME);
+		if constexpr (is_builtin_v<t>)
+			return value_t(std::in_place_type<t>, val);
+		else
+			return value_t(std::in_place_type<std::any>, std::make_any<t>(val));
 	}
 
 	/// <summary>
-	/// Creates hash of text during run-time
+	/// Returns the value held by var as the desired type
 	/// </summary>
-	/// <param name="str">The text that is going to be hashed</param>
-	/// <returns>Hashed text</returns>
-	inline hash_t get(const char* txt)
+	/// <returns>Pointer to the value, nullptr if var holds another type</returns>
+	template< typename t >
+	t* value_ptr(value_t& var)
 	{
-		hash_t ret = BASIS;
-
-		hash_t length = hash_t(strlen(txt));
-		for (auto i = 0u; i < length; ++i)
+		if constexpr (is_builtin_v<t>)
+			return std::get_if<t>(&var);
+		else
 		{
-			/// OR character and multiply it with fnv1a prime
-			ret ^= txt[i];
-			ret *= PRIME;
+			auto* any = std::get_if<std::any>(&var);
+			return any ? std::any_cast<t>(any) : nullptr;
 		}
-
-		return ret;
 	}
-}
 
-namespace config
-{
+	template< typename t >
+	const t* value_ptr(const value_t& var)
+	{
+		return value_ptr<t>(const_cast<value_t&>(var));
+	}
 
+	/// <summary>
+	/// Returns the value held by var as the desired type, switching var to that type first if needed
+	/// </summary>
+	/// <returns>Reference to the value</returns>
+	template< typename t >
+	t& value_ensure(value_t& var)
+	{
+		if (auto* cur = value_ptr<t>(var))
+			return *cur;
 
+		if constexpr (is_builtin_v<t>)
+			return var.template emplace<t>();
+		else
+			return var.template emplace<std::any>().template emplace<t>();
+	}
 
 	struct item_t
 	{
 		item_t() = default;
-		item_t(const std::string name, const hash_t type, const std::any var, const std::string section)
-			: m_name(name), m_type(type), m_var(var), m_section(section)
+		item_t(const std::string name, const hash_t type, value_t var, const std::string section)
+			: m_name(name), m_section(section), m_type(type), m_var(std::move(var))
 		{};
 
 		~item_t() = default;
 
 		/// <summary>
-		/// Cast the inner variable to the desired type and returns it
+		/// Returns the inner variable as the desired type, which has to be the type the item was registered with
 		/// </summary>
 		/// <returns>Casted variable</returns>
 		template< typename t >
 		t& get()
 		{
-			return *reinterpret_cast<t*>(std::any_cast<t>(&m_var));
+			return *value_ptr<t>(m_var);
 		}
 
 		/// <summary>
-		/// Sets the inner variable to the desired value
+		/// Sets the inner variable to the desired value, assigning in place when the type matches
 		/// </summary>
 		/// <param name="val">Value that the variable will be set to</param>
 		template< typename t >
 		void set(t val)
 		{
-			m_var.emplace<t>(val);
+			value_ensure<t>(m_var) = std::move(val);
+			mark_dirty();
+		}
+
+		/// <summary>
+		/// Flags the value as changed since the last save, needed after writing through a reference from get()
+		/// </summary>
+		void mark_dirty()
+		{
+			++m_generation;
+		}
+
+		/// <summary>
+		/// Flags the value as matching the config file up to the given generation
+		/// </summary>
+		/// <param name="generation">Generation that was written or read</param>
+		void mark_clean(const uint32_t generation)
+		{
+			m_saved_generation = generation;
+		}
+
+		/// <summary>
+		/// Was the value changed since it was last saved or loaded
+		/// </summary>
+		bool is_dirty() const
+		{
+			return m_generation != m_saved_generation;
 		}
 
 		std::string m_name;
 		std::string m_section;
 		hash_t m_type;
-		std::any m_var;
+		value_t m_var;
+		uint32_t m_generation = 0; // bumped on every change
+		uint32_t m_saved_generation = 0; // generation last written to or read from the config file
+		bool m_observed = false; // a subscription covers the item, only observed items are compared on load
 	};
 
 	/// <summary>
-	/// Returns the registered config items vector
+	/// Converts item values from and to their ini text form. One codec is registered per type hash and
+	/// shared by load_settings, save and keybind execution.
+	/// </summary>
+	struct codec_t
+	{
+		/// <summary>
+		/// Parses text into out, switching out to the codec type if needed. Returns false when text
+		/// is not a valid value, out is unspecified then, so callers go through convert_checked.
+		/// </summary>
+		bool (*parse)(std::string_view text, value_t& out);
+
+		/// <summary>
+		/// Appends the text form of in to out
+		/// </summary>
+		void (*format)(const value_t& in, std::string& out);
+
+		/// <summary>
+		/// Optional fixed binary form used by binary snapshots, types without it are stored as text
+		/// </summary>
+		bool (*decode)(std::string_view bytes, value_t& out) = nullptr;
+		void (*encode)(const value_t& in, std::string& out) = nullptr;
+
+		/// <summary>
+		/// Optional copy of one value onto another of the same type in place. Assigning a std::any
+		/// allocates a new copy, this assigns the held values instead. Set by register_type.
+		/// </summary>
+		void (*assign)(const value_t& in, value_t& out) = nullptr;
+	};
+
+	/// <summary>
+	/// Registers the codec of a type, replacing any codec registered for it before
+	/// </summary>
+	/// <param name="type">Hash of the type name as used in ADD_CFG_ITEM</param>
+	/// <param name="codec">Codec of the type</param>
+	void register_codec(const hash_t type, const codec_t codec);
+
+	/// <summary>
+	/// Gets the codec of a type, the built-in types are always registered
+	/// </summary>
+	/// <param name="type">Hash of the type name</param>
+	/// <returns>Codec of the type or nullptr</returns>
+	const codec_t* find_codec(const hash_t type);
+
+	/// <summary>
+	/// Converts with codec_t::parse or codec_t::decode and assigns the result to target only when it
+	/// succeeds, a rejected value leaves target as it was. Built-in values are swapped into place,
+	/// std::any values are converted once more in place so handles into them stay valid.
+	/// </summary>
+	/// <param name="convert">codec_t::parse or codec_t::decode</param>
+	/// <param name="text">Text or bytes to convert</param>
+	/// <param name="target">Value to assign</param>
+	/// <param name="scratch">Candidate buffer, reusing one across calls keeps its capacity</param>
+	/// <returns>Was text a valid value</returns>
+	bool convert_checked(bool (*convert)(std::string_view, value_t&), const std::string_view text, value_t& target, value_t& scratch);
+
+	/// <summary>
+	/// Registers a codec for a custom item type from typed parse and format functions, e.g.
+	/// config::register_type<my_t, parse_my_t, format_my_t>(CT_HASH("my_t"));
+	/// </summary>
+	/// <param name="type">Hash of the type name as used in ADD_CFG_ITEM</param>
+	template< typename t, bool(*parse_fn)(std::string_view, t&), void(*format_fn)(const t&, std::string&) >
+	void register_type(const hash_t type)
+	{
+		register_codec(type, codec_t{
+			[](std::string_view text, value_t& out) { return parse_fn(text, value_ensure<t>(out)); },
+			[](const value_t& in, std::string& out) {
+				if (const auto* val = value_ptr<t>(in))
+					format_fn(*val, out);
+			},
+			nullptr,
+			nullptr,
+			[](const value_t& in, value_t& out) {
+				if (const auto* val = value_ptr<t>(in))
+					value_ensure<t>(out) = *val;
+			}
+		});
+	}
+
+	/// <summary>
+	/// Registered items, a deque so items never move and typed handles can point straight at their values
+	/// </summary>
+	using items_t = std::deque<item_t>;
+
+	/// <summary>
+	/// Returns the registered config items
 	/// </summary>
 	/// <returns>Registered config items</returns>
-	std::vector<item_t>& get_items();
+	items_t& get_items();
+
+	/// <summary>
+	/// Registers an item unless an item with the same section, name and type already exists
+	/// </summary>
+	/// <param name="item">Item to register</param>
+	/// <returns>Index of the new or already registered item</returns>
+	uint32_t register_item(item_t&& item);
 
 	/// <summary>
 	/// Adds a new config item into the vector
@@ -116,16 +280,69 @@ namespace config
 	template< typename t >
 	uint32_t add_item(const std::string name, const hash_t type, const t def, const std::string section_name)
 	{
+		return register_item(item_t(name, type, make_value<t>(def), section_name));
+	}
 
-		for (size_t i = 0; i < get_items().size(); ++i) { // fix in case of multi init 
-			if (get_items()[i].m_name == name && get_items()[i].m_type == type && get_items()[i].m_section == section_name) {
-				// Item already exists, return its index
-				return static_cast<uint32_t>(i);
-			}
+	/// <summary>
+	/// Typed reference to a registered item. It caches the address of the item value, so reading
+	/// through it is a single load with no bounds or type check. The address stays valid as long as
+	/// the item is only assigned values of type t.
+	/// </summary>
+	template< typename t >
+	class cfg_handle
+	{
+	public:
+		cfg_handle(const uint32_t index)
+			: m_item(&get_items().at(index)), m_value(&m_item->template get<t>()), m_index(index)
+		{};
+
+		/// <summary>
+		/// Gets the item variable
+		/// </summary>
+		/// <returns>Item variable</returns>
+		t& get() const
+		{
+			return *m_value;
 		}
-		get_items().push_back(item_t(name, type, std::make_any<t>(def), section_name));
-		return static_cast<uint32_t>(get_items().size()) - 1u;
-	}
+
+		/// <summary>
+		/// Sets the item variable and marks the item dirty, writes through get() are not tracked
+		/// </summary>
+		/// <param name="val">Value that the variable will be set to</param>
+		void set(t val) const
+		{
+			*m_value = std::move(val);
+			m_item->mark_dirty();
+		}
+
+		t& operator*() const
+		{
+			return *m_value;
+		}
+
+		t* operator->() const
+		{
+			return m_value;
+		}
+
+		/// <summary>
+		/// Index of the item for the index based api
+		/// </summary>
+		uint32_t index() const
+		{
+			return m_index;
+		}
+
+		operator uint32_t() const
+		{
+			return m_index;
+		}
+
+	private:
+		item_t* m_item;
+		t* m_value;
+		uint32_t m_index;
+	};
 
 	/// <summary>
 	/// Gets config item variable from vector index
@@ -144,13 +361,64 @@ namespace config
 	/// <param name="index">Index of the config item</param>
 	/// <returns>Config item</returns>
 	item_t& get_item(const uint32_t index);
-	int does_item_exist(const std::string& section, const std::string& key);
 
 	/// <summary>
-	/// Saves current config
+	/// Finds a config item by section and key, both compared case-insensitively
+	/// </summary>
+	/// <param name="section">Section of the item</param>
+	/// <param name="key">Name of the item</param>
+	/// <returns>Index of the item or -1 if it is not registered</returns>
+	int does_item_exist(const std::string_view section, const std::string_view key);
+
+	enum save_flags : uint32_t
+	{
+		SAVE_DEFAULT = ini::WRITE_DEFAULT,
+		SAVE_FAST = ini::WRITE_NO_SYNC, // skips the fsync, a crash may lose the latest save but never corrupts the file
+		SAVE_KEEP_BACKUP = ini::WRITE_KEEP_BACKUP, // keeps the previous file as <config>.bak
+		SAVE_SNAPSHOT = 1u << 16, // also writes a binary snapshot (<config>.bin) that load_settings prefers while it is fresh
+	};
+
+	/// <summary>
+	/// Saves current config, the file is replaced atomically
 	/// </summary>
 	/// <param name="config">Name of the config</param>
-	void save(const std::string_view config);
+	/// <param name="flags">Combination of save_flags</param>
+	/// <returns>Was config written</returns>
+	bool save(const std::string_view config, const uint32_t flags = SAVE_DEFAULT);
+
+	/// <summary>
+	/// Saves only the items changed since the config was last loaded or saved, leaving every other
+	/// line of the file as it is. Nothing is written when no item changed. Falls back to a full
+	/// save when the file is missing or another config was loaded or saved last.
+	/// </summary>
+	/// <param name="config">Name of the config</param>
+	/// <param name="flags">Combination of save_flags</param>
+	/// <returns>Is the file up to date</returns>
+	bool save_changes(const std::string_view config, const uint32_t flags = SAVE_DEFAULT);
+
+	/// <summary>
+	/// Queues a save on the background writer thread. Values are captured on the calling thread,
+	/// which has to be the thread that sets the items, so later changes do not leak into this save.
+	/// Requests for the same config within the debounce window are coalesced into one write that
+	/// only contains the changed items, like save_changes. Snapshots (SAVE_SNAPSHOT) are only
+	/// written by the synchronous saves.
+	/// </summary>
+	/// <param name="config">Name of the config</param>
+	/// <param name="flags">Combination of save_flags</param>
+	/// <returns>Future that turns true once the write that includes this request is on disk</returns>
+	std::shared_future<bool> save_async(const std::string_view config, const uint32_t flags = SAVE_DEFAULT);
+
+	/// <summary>
+	/// Writes every queued async save right away and waits for them
+	/// </summary>
+	/// <returns>Did all async saves since the last flush succeed</returns>
+	bool flush();
+
+	/// <summary>
+	/// Sets how long the writer thread collects save_async requests before writing, default 250ms
+	/// </summary>
+	/// <param name="window">Debounce window</param>
+	void set_save_debounce(const std::chrono::milliseconds window);
 
 	/// <summary>
 	/// Loads current config
@@ -159,6 +427,37 @@ namespace config
 	/// <returns>Was config loaded</returns>
 	bool load_settings(const std::string_view config);
 
+	/// <summary>
+	/// Loads a config again, assigning only the items whose value in the file differs from the
+	/// current one. Items missing from the file keep their value. Readers see the result through
+	/// the next snapshot, which is published when anything changed.
+	/// </summary>
+	/// <param name="config">Name of the config</param>
+	/// <param name="on_change">Called with the index of every changed item after all of them are applied</param>
+	/// <returns>Number of changed items</returns>
+	size_t reload_settings(const std::string_view config, const std::function<void(uint32_t)>& on_change = {});
+
+	/// <summary>
+	/// Same as reload_settings, for a config file given by its full path instead of its name in
+	/// the config directory
+	/// </summary>
+	/// <param name="config_path">Path of the config file</param>
+	/// <param name="on_change">Called with the index of every changed item after all of them are applied</param>
+	/// <returns>Number of changed items</returns>
+	size_t reload_file(const std::filesystem::path& config_path, const std::function<void(uint32_t)>& on_change = {});
+
+	struct loaded_config_t
+	{
+		std::string path; // empty if nothing was loaded or saved yet
+		std::filesystem::file_time_type write_time; // of the file when it was last loaded or saved
+	};
+
+	/// <summary>
+	/// Gets the config file the items were last loaded from or saved to
+	/// </summary>
+	/// <returns>Path and write time of the config file</returns>
+	loaded_config_t get_loaded_config();
+
 	/// <summary>
 	/// Sets the name of the current config directory
 	/// </summary>
@@ -210,13 +509,13 @@ namespace config
 #define HASH( str ) shared::hash::get( str )
 
 
-#define ADD_CFG_ITEM(type, name, def, section) const uint32_t c_##section##_##name = config::add_item<type>((#name),CT_HASH(#type), def, (#section)); // returns index key 
+#define ADD_CFG_ITEM(type, name, def, section) const config::cfg_handle<type> c_##section##_##name = config::add_item<type>((#name),CT_HASH(#type), def, (#section)); // returns typed handle, converts to the index key
 
 #define ADD_CFG_ITEM_VEC(type, datatype, size, name, def, section) \
-    const uint32_t name = config::add_item<std::vector<datatype>>((#name), CT_HASH(#type), config::create_filled_vector<datatype, size>(def), (#section));
+    const config::cfg_handle<std::vector<datatype>> name = config::add_item<std::vector<datatype>>((#name), CT_HASH(#type), config::create_filled_vector<datatype, size>(def), (#section));
 
-#define ADD_CFG_ITEM_HASHED(type, name, def, section) const uint32_t name = config::add_item<type>(CT_HASH(#name),CT_HASH(#type), def, CT_HASH(#section)); // returns index key 
+#define ADD_CFG_ITEM_HASHED(type, name, def, section) const config::cfg_handle<type> name = config::add_item<type>(CT_HASH(#name),CT_HASH(#type), def, CT_HASH(#section)); // returns typed handle, converts to the index key
 
 #define ADD_CFG_ITEM_VEC_HASHED(type, datatype, size, name, def, section) \
-    const uint32_t name = config::add_item<std::vector<datatype>>(CT_HASH(#name), CT_HASH(#type), config::create_filled_vector<datatype, size>(def), CT_HASH(#section));
+    const config::cfg_handle<std::vector<datatype>> name = config::add_item<std::vector<datatype>>(CT_HASH(#name), CT_HASH(#type), config::create_filled_vector<datatype, size>(def), CT_HASH(#section));
 #endif // CONFIG_H
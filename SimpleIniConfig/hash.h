@@ -0,0 +1,86 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+using hash_t = uint32_t;
+namespace shared::hash
+{
+	constexpr uint64_t BASIS = 0x811c9dc5;
+	constexpr uint64_t PRIME = 0x1000193;
+
+	/// <summary>
+	/// Creates hash of text during compile-time
+	/// </summary>
+	/// <param name="txt">The text that is going to be hashed</param>
+	/// <param name="value">The current hash value</param>
+	/// <returns>Hashed text</returns>
+	inline constexpr hash_t get_const(const char* txt, const hash_t value = BASIS) noexcept
+	{
+		/// Recursive hashing
+		return (txt[0] == '\0') ? value :
+			get_const(&txt[1], (value ^ hash_t(txt[0])) * PRIME);
+	}
+
+	/// <summary>
+	/// Creates hash of text during run-time
+	/// </summary>
+	/// <param name="str">The text that is going to be hashed</param>
+	/// <returns>Hashed text</returns>
+	inline hash_t get(const char* txt)
+	{
+		hash_t ret = BASIS;
+
+		hash_t length = hash_t(strlen(txt));
+		for (auto i = 0u; i < length; ++i)
+		{
+			/// OR character and multiply it with fnv1a prime
+			ret ^= txt[i];
+			ret *= PRIME;
+		}
+
+		return ret;
+	}
+
+	/// <summary>
+	/// Creates hash of text during run-time
+	/// </summary>
+	/// <param name="txt">The text that is going to be hashed</param>
+	/// <param name="value">The current hash value</param>
+	/// <returns>Hashed text</returns>
+	inline hash_t get(const std::string_view txt, hash_t value = BASIS) noexcept
+	{
+		for (const char c : txt)
+		{
+			value ^= hash_t(c);
+			value *= PRIME;
+		}
+
+		return value;
+	}
+
+	/// <summary>
+	/// Lowercases an ascii character, other bytes are returned unchanged
+	/// </summary>
+	inline constexpr char fold(const char c) noexcept
+	{
+		return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+	}
+
+	/// <summary>
+	/// Creates case-insensitive hash of text during run-time
+	/// </summary>
+	/// <param name="txt">The text that is going to be hashed</param>
+	/// <param name="value">The current hash value</param>
+	/// <returns>Hashed text</returns>
+	inline hash_t get_folded(const std::string_view txt, hash_t value = BASIS) noexcept
+	{
+		for (const char c : txt)
+		{
+			value ^= hash_t(fold(c));
+			value *= PRIME;
+		}
+
+		return value;
+	}
+}
@@ -1,7 +1,158 @@
 #include "iniconfig.h"
 #include "kbinds.h"
+#include "numconv.h"
+#include "stats.h"
+#include <cstdio>
+#include <filesystem>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 namespace ini {
-    void Write_internal(const std::string& section, const std::string& key, const std::string& value, const std::string& file) {
+    void FlatINIParser::parse(std::string_view content, bool reverseKeyValue) {
+        INIParser::parse_view(content, [this](std::string_view section, std::string_view key, std::string_view value) {
+            const hash_t sectionHash = shared::hash::get(section);
+            const hash_t hash = combine(sectionHash, key);
+
+            if ((records.size() + 1) * 2 > slots.size()) {
+                grow();
+            }
+            const size_t slot = find_slot(hash, section, key);
+            if (slots[slot] != 0) {
+                records[slots[slot] - 1].value = value; // last write wins
+                return;
+            }
+            slots[slot] = static_cast<uint32_t>(records.size()) + 1u;
+            records.push_back(Record{ section, key, value, sectionHash, hash });
+        }, reverseKeyValue);
+    }
+
+    const std::string_view* FlatINIParser::find(std::string_view section, std::string_view key) const {
+        if (slots.empty()) {
+            return nullptr;
+        }
+        const size_t slot = find_slot(combine(shared::hash::get(section), key), section, key);
+        return slots[slot] != 0 ? &records[slots[slot] - 1].value : nullptr;
+    }
+
+    size_t FlatINIParser::find_slot(hash_t hash, std::string_view section, std::string_view key) const {
+        const size_t mask = slots.size() - 1;
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask) { // linear probing
+            if (slots[slot] == 0) {
+                return slot;
+            }
+            const auto& record = records[slots[slot] - 1];
+            if (record.hash == hash && record.key == key && record.section == section) {
+                return slot;
+            }
+        }
+    }
+
+    void FlatINIParser::grow() {
+        slots.assign(slots.empty() ? 64 : slots.size() * 2, 0);
+        const size_t mask = slots.size() - 1;
+        for (size_t i = 0; i < records.size(); ++i) {
+            size_t slot = records[i].hash & mask;
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = static_cast<uint32_t>(i) + 1u;
+        }
+    }
+
+    MappedFile::MappedFile(const std::string& file) {
+#ifdef _WIN32
+        HANDLE handle = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (handle == INVALID_HANDLE_VALUE) {
+            return;
+        }
+        fileHandle = handle;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(handle, &fileSize)) {
+            close();
+            return;
+        }
+        opened = true;
+        if (fileSize.QuadPart == 0) {
+            return; // empty files cannot be mapped
+        }
+
+        mappingHandle = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mappingHandle) {
+            close();
+            return;
+        }
+        data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (!data) {
+            close();
+            return;
+        }
+        size = static_cast<size_t>(fileSize.QuadPart);
+#else
+        fd = open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close();
+            return;
+        }
+        opened = true;
+        if (info.st_size == 0) {
+            return; // empty files cannot be mapped
+        }
+
+        void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close();
+            return;
+        }
+        madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+        data = static_cast<const char*>(mapping);
+        size = static_cast<size_t>(info.st_size);
+#endif
+    }
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    void MappedFile::close() {
+#ifdef _WIN32
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mappingHandle) {
+            CloseHandle(mappingHandle);
+        }
+        if (fileHandle) {
+            CloseHandle(fileHandle);
+        }
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+#else
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        fd = -1;
+#endif
+        data = nullptr;
+        size = 0;
+        opened = false;
+    }
+
+    bool Write_internal(const std::string& section, const std::string& key, const std::string& value, const std::string& file) {
         std::ifstream in(file);
         std::ostringstream temp;
         std::string line;
@@ -39,62 +190,295 @@ namespace ini {
 
         in.close();
 
-        std::ofstream out(file);
-        out << temp.str();
-        out.close();
+        return WriteFileAtomic(file, temp.str());
     }
 
-    void Write(const std::string& section, const std::string& key, int value, const std::string& file) {
-        Write_internal(section, key, std::to_string(value), file);
+    namespace {
+        std::string_view TrimView(std::string_view str) {
+            auto start = str.find_first_not_of(" \t\r");
+            auto end = str.find_last_not_of(" \t\r");
+            if (start == std::string_view::npos || end == std::string_view::npos) {
+                return {};
+            }
+            return str.substr(start, end - start + 1);
+        }
     }
 
-    void Write(const std::string& section, const std::string& key, AmiKeyBind value, const std::string& file) {
-        Write_internal(section, key, std::to_string(value.Get()), file);
+    bool WriteBatch(const std::vector<Entry>& entries, const std::string& file, uint32_t flags) {
+        // Entries grouped per section in the order they were queued
+        struct PendingSection {
+            std::string_view name;
+            std::vector<const Entry*> entries{};
+            std::unordered_map<std::string_view, size_t> keys{};
+            std::vector<bool> written{};
+            bool seen = false;
+        };
+
+        std::vector<PendingSection> pending;
+        std::unordered_map<std::string_view, size_t> sectionIndex;
+        for (const auto& entry : entries) {
+            auto [it, inserted] = sectionIndex.try_emplace(entry.section, pending.size());
+            if (inserted) {
+                pending.push_back(PendingSection{ entry.section });
+            }
+            auto& section = pending[it->second];
+            if (section.keys.try_emplace(entry.key, section.entries.size()).second) {
+                section.entries.push_back(&entry);
+                section.written.push_back(false);
+            }
+            else {
+                section.entries[section.keys[entry.key]] = &entry; // last write wins
+            }
+        }
+
+        std::string content;
+        {
+            std::ifstream in(file);
+            content.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        config::stats::add(config::stats::BYTES_READ, content.size());
+
+        std::string out;
+        out.reserve(content.size() + entries.size() * 32);
+
+        PendingSection* current = nullptr;
+        // Blank lines are held back so missing keys land right after the last key of their section
+        std::string heldBlank;
+        auto appendEntry = [&out](const Entry& entry) {
+            out += entry.key;
+            out += '=';
+            out += entry.value;
+            out += '\n';
+        };
+        auto flushSection = [&]() {
+            if (!current) {
+                return;
+            }
+            for (size_t i = 0; i < current->entries.size(); ++i) {
+                if (!current->written[i]) {
+                    appendEntry(*current->entries[i]);
+                    current->written[i] = true;
+                }
+            }
+        };
+
+        size_t pos = 0;
+        while (pos < content.size()) {
+            size_t eol = content.find('\n', pos);
+            if (eol == std::string::npos) {
+                eol = content.size();
+            }
+            std::string_view line(content.data() + pos, eol - pos);
+            pos = eol + 1;
+
+            auto trimmed = TrimView(line);
+            if (trimmed.empty()) {
+                heldBlank.append(line);
+                heldBlank += '\n';
+                continue;
+            }
+
+            if (trimmed.size() > 2 && trimmed.front() == '[' && trimmed.back() == ']') {
+                flushSection();
+                out += heldBlank;
+                heldBlank.clear();
+
+                auto it = sectionIndex.find(trimmed.substr(1, trimmed.size() - 2));
+                current = it == sectionIndex.end() ? nullptr : &pending[it->second];
+                if (current) {
+                    current->seen = true;
+                }
+                out.append(line);
+                out += '\n';
+                continue;
+            }
+
+            out += heldBlank;
+            heldBlank.clear();
+
+            if (current) {
+                auto separator = trimmed.find('=');
+                if (separator != std::string_view::npos) {
+                    auto it = current->keys.find(TrimView(trimmed.substr(0, separator)));
+                    if (it != current->keys.end()) {
+                        appendEntry(*current->entries[it->second]);
+                        current->written[it->second] = true;
+                        continue;
+                    }
+                }
+            }
+            out.append(line);
+            out += '\n';
+        }
+        flushSection();
+        out += heldBlank;
+
+        // Sections that are not in the file yet go to the end
+        for (auto& section : pending) {
+            if (section.seen) {
+                continue;
+            }
+            out += out.empty() ? "[" : "\n[";
+            out.append(section.name);
+            out += "]\n";
+            for (const Entry* entry : section.entries) {
+                appendEntry(*entry);
+            }
+        }
+
+        return WriteFileAtomic(file, out, flags);
     }
 
-    void Write(const std::string& section, const std::string& key, const shared::col_t& color, const std::string& file) {
-        std::string concatenated = std::to_string(color.r()) + "," +
-            std::to_string(color.g()) + "," +
-            std::to_string(color.b()) + "," +
-            std::to_string(color.a());
-        Write_internal(section, key, concatenated, file);
+    bool WriteFileAtomic(const std::string& file, std::string_view content, uint32_t flags) {
+        const bool sync = !(flags & WRITE_NO_SYNC);
+        const std::string tempFile = file + ".tmp";
+
+        // Text mode by default so line endings match what std::ofstream used to produce
+        const char* mode = (flags & WRITE_BINARY) ? "wb" : "w";
+        FILE* out = nullptr;
+#ifdef _WIN32
+        if (fopen_s(&out, tempFile.c_str(), mode) != 0) {
+            out = nullptr;
+        }
+#else
+        out = std::fopen(tempFile.c_str(), mode);
+#endif
+        if (!out) {
+            return false;
+        }
+
+        bool ok = std::fwrite(content.data(), 1, content.size(), out) == content.size();
+        ok = std::fflush(out) == 0 && ok;
+        if (ok && sync) {
+#ifdef _WIN32
+            ok = _commit(_fileno(out)) == 0;
+#else
+            ok = fsync(fileno(out)) == 0;
+#endif
+        }
+        ok = std::fclose(out) == 0 && ok;
+        if (!ok) {
+            std::remove(tempFile.c_str());
+            return false;
+        }
+        config::stats::add(config::stats::BYTES_WRITTEN, content.size());
+
+        // The rename keeps the temp file's default mode, carry over the permissions of the file it replaces
+        std::error_code err;
+        const auto previous = std::filesystem::status(file, err);
+        if (!err && std::filesystem::exists(previous)) {
+            std::filesystem::permissions(tempFile, previous.permissions(), err);
+        }
+        if ((flags & WRITE_KEEP_BACKUP) && std::filesystem::exists(file, err)) {
+            std::filesystem::copy_file(file, file + ".bak", std::filesystem::copy_options::overwrite_existing, err);
+        }
+
+#ifdef _WIN32
+        DWORD moveFlags = MOVEFILE_REPLACE_EXISTING | (sync ? MOVEFILE_WRITE_THROUGH : 0);
+        if (!MoveFileExA(tempFile.c_str(), file.c_str(), moveFlags)) {
+            std::remove(tempFile.c_str());
+            return false;
+        }
+#else
+        if (std::rename(tempFile.c_str(), file.c_str()) != 0) {
+            std::remove(tempFile.c_str());
+            return false;
+        }
+        if (sync) {
+            // Persist the directory entry too, otherwise the rename itself may be lost
+            auto parent = std::filesystem::path(file).parent_path();
+            int dir = open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY);
+            if (dir >= 0) {
+                fsync(dir);
+                close(dir);
+            }
+        }
+#endif
+        return true;
+    }
+
+    std::string Format(int value) {
+        return shared::num::to_string(value);
+    }
+
+    std::string Format(AmiKeyBind value) {
+        return shared::num::to_string(value.Get());
+    }
+
+    std::string Format(const shared::col_t& color) {
+        std::string concatenated;
+        shared::num::append_color(concatenated, color);
+        return concatenated;
     }
-    void Write(const std::string& section, const std::string& key, float value, const std::string& file) {
-        Write_internal(section, key, std::to_string(value), file);
+
+    std::string Format(float value) {
+        return shared::num::to_string(value);
     }
 
-    void Write(const std::string& section, const std::string& key, bool value, const std::string& file) {
-        Write_internal(section, key, value ? "true" : "false", file);
+    std::string Format(bool value) {
+        return value ? "true" : "false";
     }
 
-    void Write(const std::string& section, const std::string& key, const std::vector<int>& values, const std::string& file) {
+    std::string Format(const std::vector<int>& values) {
         std::string concatenated = "";
         for (size_t i = 0; i < values.size(); ++i) {
-            concatenated += std::to_string(values[i]);
+            shared::num::append(concatenated, values[i]);
             if (i != values.size() - 1) { // Check if it's not the last element
                 concatenated += ",";
             }
         }
-        Write_internal(section, key, concatenated, file);
+        return concatenated;
     }
 
-    void Write(const std::string& section, const std::string& key, const std::vector<float>& values, const std::string& file) {
+    std::string Format(const std::vector<float>& values) {
         std::string concatenated = "";
         for (size_t i = 0; i < values.size(); ++i) {
-            concatenated += std::to_string(values[i]);
+            shared::num::append(concatenated, values[i]);
             if (i != values.size() - 1) { // Check if it's not the last element
                 concatenated += ",";
             }
         }
-        Write_internal(section, key, concatenated, file);
+        return concatenated;
     }
 
-    void Write(const std::string& section, const std::string& key, const std::vector<bool>& values, const std::string& file) {
+    std::string Format(const std::vector<bool>& values) {
         std::string concatenated = "";
         for (bool val : values) {
             concatenated += val ? "true," : "false,";
         }
-        Write_internal(section, key, concatenated, file);
+        return concatenated;
+    }
+
+    bool Write(const std::string& section, const std::string& key, int value, const std::string& file) {
+        return Write_internal(section, key, Format(value), file);
+    }
+
+    bool Write(const std::string& section, const std::string& key, AmiKeyBind value, const std::string& file) {
+        return Write_internal(section, key, Format(value), file);
+    }
+
+    bool Write(const std::string& section, const std::string& key, const shared::col_t& color, const std::string& file) {
+        return Write_internal(section, key, Format(color), file);
+    }
+
+    bool Write(const std::string& section, const std::string& key, float value, const std::string& file) {
+        return Write_internal(section, key, Format(value), file);
+    }
+
+    bool Write(const std::string& section, const std::string& key, bool value, const std::string& file) {
+        return Write_internal(section, key, Format(value), file);
+    }
+
+    bool Write(const std::string& section, const std::string& key, const std::vector<int>& values, const std::string& file) {
+        return Write_internal(section, key, Format(values), file);
+    }
+
+    bool Write(const std::string& section, const std::string& key, const std::vector<float>& values, const std::string& file) {
+        return Write_internal(section, key, Format(values), file);
+    }
+
+    bool Write(const std::string& section, const std::string& key, const std::vector<bool>& values, const std::string& file) {
+        return Write_internal(section, key, Format(values), file);
     }
 
 }
@@ -4,7 +4,11 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <string_view>
 #include "color.h"
+#include "hash.h"
+#include "iniscan.h"
 // Forward declaration
 class AmiKeyBind;
 
@@ -16,62 +20,184 @@ namespace ini {
         std::map<std::string, std::map<std::string, std::string>> sections;
 
         void parse(const std::string& content, bool reverseKeyValue = false) {
-            std::stringstream ss(content);
-            std::string line;
-            std::string currentSection;
+            parse_view(content, [this](std::string_view section, std::string_view key, std::string_view value) {
+                sections[std::string(section)][std::string(key)] = std::string(value);
+            }, reverseKeyValue);
+        }
+
+        // Calls callback(section, key, value) for every key of content in file order. Nothing is
+        // copied or allocated, the views point into content and live as long as it does.
+        template <typename Callback>
+        static void parse_view(std::string_view content, Callback&& callback, bool reverseKeyValue = false) {
+            std::string_view currentSection;
+            size_t pos = 0;
+
+            while (pos < content.size()) {
+                size_t separator;
+                const size_t lineStart = pos;
+                const size_t eol = scan::find_line(content, pos, separator);
+                pos = eol + 1;
+
+                std::string_view line = trim(content.substr(lineStart, eol - lineStart));
+                if (line.empty() || line[0] == ';' || line[0] == '#') {
+                    continue; // Blank line or comment
+                }
 
-            while (std::getline(ss, line)) {
-                line = trim(line);
                 if (line.size() > 2 && line[0] == '[' && line[line.size() - 1] == ']') {
                     currentSection = line.substr(1, line.size() - 2);
                 }
                 else {
-                    auto separator = line.find('=');
-                    if (separator == std::string::npos) {
+                    if (separator == scan::npos) {
                         continue; // Invalid line, skip
                     }
 
-                    std::string key, value;
+                    std::string_view left = trim(content.substr(lineStart, separator - lineStart));
+                    std::string_view right = trim(content.substr(separator + 1, eol - separator - 1));
                     if (reverseKeyValue) {
-                        key = trim(line.substr(separator + 1));
-                        value = trim(line.substr(0, separator));
+                        callback(currentSection, right, left);
                     }
                     else {
-                        key = trim(line.substr(0, separator));
-                        value = trim(line.substr(separator + 1));
+                        callback(currentSection, left, right);
                     }
-                    sections[currentSection][key] = value;
                 }
             }
         }
     private:
-        std::string trim(const std::string& str) {
-            auto start = str.find_first_not_of(" \t");
-            auto end = str.find_last_not_of(" \t");
-            if (start == std::string::npos || end == std::string::npos) {
-                return "";
+        static std::string_view trim(std::string_view str) {
+            auto start = str.find_first_not_of(" \t\r");
+            auto end = str.find_last_not_of(" \t\r");
+            if (start == std::string_view::npos || end == std::string_view::npos) {
+                return {};
             }
             return str.substr(start, end - start + 1);
         }
     };
 
-    void Write_internal(const std::string& section, const std::string& key, const std::string& value, const std::string& file);
+    // Alternative to INIParser that keeps every entry in one flat array of views into the parsed
+    // content (which has to outlive the parser) plus an open addressing index over precomputed
+    // FNV-1a hashes. Entries iterate in file order and point lookups touch one or two slots.
+    class FlatINIParser {
+    public:
+        struct Record {
+            std::string_view section;
+            std::string_view key;
+            std::string_view value;
+            hash_t sectionHash;
+            hash_t hash; // section and key combined
+        };
+
+        void parse(std::string_view content, bool reverseKeyValue = false);
+
+        // Value stored for section/key, nullptr if there is none
+        const std::string_view* find(std::string_view section, std::string_view key) const;
+
+        std::string_view get(std::string_view section, std::string_view key, std::string_view fallback = {}) const {
+            const auto* value = find(section, key);
+            return value ? *value : fallback;
+        }
+
+        // Calls callback(key, value) for every key of section in file order
+        template <typename Callback>
+        void for_each_in_section(std::string_view section, Callback&& callback) const {
+            const hash_t sectionHash = shared::hash::get(section);
+            for (const auto& record : records) {
+                if (record.sectionHash == sectionHash && record.section == section) {
+                    callback(record.key, record.value);
+                }
+            }
+        }
+
+        // Every entry in file order, duplicate keys keep the last value like INIParser
+        std::vector<Record> records;
+
+    private:
+        static hash_t combine(hash_t sectionHash, std::string_view key) {
+            return shared::hash::get(key, (sectionHash ^ hash_t('.')) * hash_t(shared::hash::PRIME));
+        }
+        size_t find_slot(hash_t hash, std::string_view section, std::string_view key) const;
+        void grow();
+
+        std::vector<uint32_t> slots; // record index + 1, 0 marks an empty slot
+    };
+
+    // Read-only view of a whole file, memory mapped so parsing does not need to copy it
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::string& file);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool is_open() const { return opened; }
+        std::string_view view() const { return { data, size }; }
+
+    private:
+        void close();
+
+        const char* data = nullptr;
+        size_t size = 0;
+        bool opened = false;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#else
+        int fd = -1;
+#endif
+    };
+
+    // Flags controlling how WriteFileAtomic / WriteBatch commit a file to disk
+    enum WriteFlags : uint32_t {
+        WRITE_DEFAULT = 0,
+        WRITE_NO_SYNC = 1 << 0,     // skip flushing the file to the device (fast, not crash safe)
+        WRITE_KEEP_BACKUP = 1 << 1, // keep the previous generation as <file>.bak
+        WRITE_BINARY = 1 << 2,      // write the content as is, without text mode newline translation
+    };
+
+    // Writes content to a sibling temp file, flushes it to disk and renames it over file, so a
+    // crash leaves either the old or the new file but never a truncated one. The new file gets
+    // the permissions of the one it replaces.
+    bool WriteFileAtomic(const std::string& file, std::string_view content, uint32_t flags = WRITE_DEFAULT);
+
+    // A single key/value pair queued for WriteBatch
+    struct Entry {
+        std::string section;
+        std::string key;
+        std::string value;
+    };
+
+    // Applies every entry to file in one read and one write. Unknown keys, comments and the
+    // existing section order are kept, missing keys are appended to their section and missing
+    // sections are appended to the end of the file.
+    bool WriteBatch(const std::vector<Entry>& entries, const std::string& file, uint32_t flags = WRITE_DEFAULT);
+
+    bool Write_internal(const std::string& section, const std::string& key, const std::string& value, const std::string& file);
+    // Value formatting shared by Write and WriteBatch callers
+    std::string Format(const shared::col_t& color);
+    std::string Format(AmiKeyBind value);
+    std::string Format(int value);
+    std::string Format(float value);
+    std::string Format(bool value);
+    std::string Format(const std::vector<int>& values);
+    std::string Format(const std::vector<float>& values);
+    std::string Format(const std::vector<bool>& values);
     // Overloads for types
     //col
-    void Write(const std::string& section, const std::string& key, const shared::col_t& color, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, const shared::col_t& color, const std::string& file);
     //keybind
-    void Write(const std::string& section, const std::string& key, AmiKeyBind value, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, AmiKeyBind value, const std::string& file);
     // int
-    void Write(const std::string& section, const std::string& key, int value, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, int value, const std::string& file);
     // float
-    void Write(const std::string& section, const std::string& key, float value, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, float value, const std::string& file);
     // bool
-    void Write(const std::string& section, const std::string& key, bool value, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, bool value, const std::string& file);
     // vector<int>
-    void Write(const std::string& section, const std::string& key, const std::vector<int>& values, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, const std::vector<int>& values, const std::string& file);
     // vector<float>
-    void Write(const std::string& section, const std::string& key, const std::vector<float>& values, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, const std::vector<float>& values, const std::string& file);
     // vector<bool>
-    void Write(const std::string& section, const std::string& key, const std::vector<bool>& values, const std::string& file);
+    bool Write(const std::string& section, const std::string& key, const std::vector<bool>& values, const std::string& file);
 }
 
@@ -0,0 +1,156 @@
+#include "iniscan.h"
+#include <bit>
+#include <cstdint>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define INI_SCAN_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define INI_TARGET_SSE2
+#define INI_TARGET_AVX2
+#else
+#define INI_TARGET_SSE2 __attribute__((target("sse2")))
+#define INI_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace ini::scan {
+    namespace {
+        using kernel_t = size_t(*)(const char* data, size_t pos, size_t size, size_t& separator);
+
+        size_t find_line_scalar(const char* data, size_t pos, size_t size, size_t& separator) {
+            for (; pos < size; ++pos) {
+                const char c = data[pos];
+                if (c == '\n') {
+                    return pos;
+                }
+                if (c == '=' && separator == npos) {
+                    separator = pos;
+                }
+            }
+            return size;
+        }
+
+#ifdef INI_SCAN_X86
+        // Records the first '=' of the block that comes before the newline (if any) and returns
+        // the newline position, or npos when the block has none
+        inline size_t resolve_block(size_t pos, uint32_t newlines, uint32_t equals, size_t& separator) {
+            if (newlines) {
+                equals &= (newlines & (0u - newlines)) - 1u; // only bytes before the first newline
+            }
+            if (equals && separator == npos) {
+                separator = pos + std::countr_zero(equals);
+            }
+            return newlines ? pos + std::countr_zero(newlines) : npos;
+        }
+
+        INI_TARGET_SSE2 size_t find_line_sse2(const char* data, size_t pos, size_t size, size_t& separator) {
+            const __m128i newline = _mm_set1_epi8('\n');
+            const __m128i equals = _mm_set1_epi8('=');
+            for (; pos + 16 <= size; pos += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+                const auto newlines = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, newline)));
+                const auto separators = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, equals)));
+                const size_t eol = resolve_block(pos, newlines, separators, separator);
+                if (eol != npos) {
+                    return eol;
+                }
+            }
+            return find_line_scalar(data, pos, size, separator);
+        }
+
+        INI_TARGET_AVX2 size_t find_line_avx2(const char* data, size_t pos, size_t size, size_t& separator) {
+            const __m256i newline = _mm256_set1_epi8('\n');
+            const __m256i equals = _mm256_set1_epi8('=');
+            for (; pos + 32 <= size; pos += 32) {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+                const auto newlines = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, newline)));
+                const auto separators = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, equals)));
+                const size_t eol = resolve_block(pos, newlines, separators, separator);
+                if (eol != npos) {
+                    return eol;
+                }
+            }
+            return find_line_sse2(data, pos, size, separator);
+        }
+
+        bool cpu_has_avx2() {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+                return false; // the OS does not save ymm registers
+            }
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        bool cpu_has_sse2() {
+#if defined(_M_X64) || defined(__x86_64__)
+            return true;
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[3] & (1 << 26)) != 0;
+#else
+            return __builtin_cpu_supports("sse2");
+#endif
+        }
+#endif
+
+        struct dispatch_t {
+            kernel_t kernel = find_line_scalar;
+            const char* name = "scalar";
+
+            dispatch_t() {
+                select({});
+            }
+
+            bool select(std::string_view wanted) {
+                if (wanted.empty() || wanted == "scalar") {
+                    kernel = find_line_scalar;
+                    name = "scalar";
+                }
+#ifdef INI_SCAN_X86
+                if ((wanted.empty() || wanted == "avx2") && cpu_has_avx2()) {
+                    kernel = find_line_avx2;
+                    name = "avx2";
+                }
+                else if ((wanted.empty() || wanted == "sse2") && cpu_has_sse2()) {
+                    kernel = find_line_sse2;
+                    name = "sse2";
+                }
+#endif
+                return wanted.empty() || wanted == name;
+            }
+        };
+
+        dispatch_t& get_dispatch() {
+            static dispatch_t dispatch;
+            return dispatch;
+        }
+    }
+
+    size_t find_line(std::string_view text, size_t pos, size_t& separator) {
+        separator = npos;
+        return get_dispatch().kernel(text.data(), pos, text.size(), separator);
+    }
+
+    const char* kernel_name() {
+        return get_dispatch().name;
+    }
+
+    bool select_kernel(std::string_view name) {
+        return get_dispatch().select(name);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// Vectorized byte scanning used by ini::INIParser. The widest kernel the cpu supports
+// (AVX2, SSE2 or plain scalar) is picked once at startup.
+namespace ini::scan {
+    constexpr size_t npos = std::string_view::npos;
+
+    // Returns the index of the '\n' ending the line that starts at pos (text.size() if it is the
+    // last line) and sets separator to the index of the first '=' on that line, or npos.
+    size_t find_line(std::string_view text, size_t pos, size_t& separator);
+
+    // Name of the kernel find_line dispatches to, for diagnostics and benchmarks
+    const char* kernel_name();
+
+    // Forces a kernel ("scalar", "sse2" or "avx2") for tests and benchmarks, an empty name picks the
+    // widest one again. Returns false if the cpu lacks the kernel, the current one is kept then.
+    // Not thread safe, call it while nothing is being parsed.
+    bool select_kernel(std::string_view name);
+}
@@ -0,0 +1,727 @@
+#include "input.h"
+#include "numconv.h"
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+#ifdef __linux__
+#include <cerrno>
+#include <filesystem>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace input
+{
+	key_state_t source_t::snapshot()
+	{
+		key_state_t state;
+		for (int key = 1; key < KEY_COUNT; ++key)
+		{
+			if (is_down(key))
+				state.set(key);
+		}
+		return state;
+	}
+
+	int source_t::first_down()
+	{
+		return snapshot().first();
+	}
+
+	std::string source_t::key_name(const int key)
+	{
+		return default_key_name(key);
+	}
+
+	void source_t::wait(const std::chrono::milliseconds duration)
+	{
+		std::this_thread::sleep_for(duration);
+	}
+
+	bool source_t::wait_for_change()
+	{
+		if (m_interrupted.exchange(false))
+			return false; // interrupted while nobody was waiting
+		std::this_thread::sleep_for(POLL_INTERVAL);
+		m_last_change = std::chrono::steady_clock::now();
+		return !m_interrupted.exchange(false);
+	}
+
+	void source_t::interrupt()
+	{
+		m_interrupted = true;
+	}
+
+	std::chrono::steady_clock::time_point source_t::last_change_time()
+	{
+		return m_last_change;
+	}
+
+	std::string default_key_name(const int key)
+	{
+		switch (key) {
+		case vk::MBUTTON: return "Middle Mouse Button";
+		case vk::LBUTTON: return "Left Mouse Button";
+		case vk::RBUTTON: return "Right Mouse Button";
+		case vk::XBUTTON1: return "X Button 1";
+		case vk::XBUTTON2: return "X Button 2";
+		case vk::CONTROL: return "Control Key";
+		case vk::MENU: return "Alt Key";
+		case vk::SHIFT: return "Shift Key";
+		case vk::CAPITAL: return "Caps Lock";
+		case vk::NUMLOCK: return "Num Lock";
+		case vk::SCROLL: return "Scroll Lock";
+		case vk::BACK: return "Backspace";
+		case vk::TAB: return "Tab";
+		case vk::RETURN: return "Enter";
+		case vk::PAUSE: return "Pause";
+		case vk::ESCAPE: return "Esc";
+		case vk::SPACE: return "Space";
+		case vk::PRIOR: return "Page Up";
+		case vk::NEXT: return "Page Down";
+		case vk::END: return "End";
+		case vk::HOME: return "Home";
+		case vk::LEFT: return "Left";
+		case vk::UP: return "Up";
+		case vk::RIGHT: return "Right";
+		case vk::DOWN: return "Down";
+		case vk::INSERT: return "Insert";
+		case vk::DEL: return "Delete";
+		case vk::LSHIFT: return "Left Shift";
+		case vk::RSHIFT: return "Right Shift";
+		case vk::LCONTROL: return "Left Control";
+		case vk::RCONTROL: return "Right Control";
+		case vk::LMENU: return "Left Alt";
+		case vk::RMENU: return "Right Alt";
+		default: break;
+		}
+
+		if ((key >= vk::DIGIT_0 && key <= vk::DIGIT_0 + 9) || (key >= vk::LETTER_A && key < vk::LETTER_A + 26))
+			return std::string(1, static_cast<char>(key));
+		if (key >= vk::NUMPAD0 && key <= vk::NUMPAD0 + 9)
+			return "Num " + std::to_string(key - vk::NUMPAD0);
+		if (key >= vk::F1 && key < vk::F1 + 24)
+			return "F" + std::to_string(key - vk::F1 + 1);
+		return "Unknown Key: " + std::to_string(key);
+	}
+
+	namespace
+	{
+		// Reports no key as held, the default where the platform has no source
+		class null_source_t : public source_t
+		{
+		public:
+			bool is_down(const int) override
+			{
+				return false;
+			}
+
+			bool wait_for_change() override
+			{
+				// nothing ever changes, sleep until interrupted
+				std::unique_lock lock(m_mutex);
+				m_wake.wait(lock, [this] { return m_interrupted.load(); });
+				m_interrupted = false;
+				return false;
+			}
+
+			void interrupt() override
+			{
+				{
+					std::lock_guard lock(m_mutex);
+					m_interrupted = true;
+				}
+				m_wake.notify_all();
+			}
+
+		private:
+			std::mutex m_mutex;
+			std::condition_variable m_wake;
+		};
+
+		// Generic modifiers are held when either side is
+		bool is_down_either(const int key, const key_state_t& state)
+		{
+			switch (key) {
+			case vk::SHIFT: return state.test(vk::LSHIFT) || state.test(vk::RSHIFT);
+			case vk::CONTROL: return state.test(vk::LCONTROL) || state.test(vk::RCONTROL);
+			case vk::MENU: return state.test(vk::LMENU) || state.test(vk::RMENU);
+			default: return state.test(key);
+			}
+		}
+
+		key_state_t with_generic_modifiers(key_state_t state)
+		{
+			state.set(vk::SHIFT, state.test(vk::LSHIFT) || state.test(vk::RSHIFT));
+			state.set(vk::CONTROL, state.test(vk::LCONTROL) || state.test(vk::RCONTROL));
+			state.set(vk::MENU, state.test(vk::LMENU) || state.test(vk::RMENU));
+			return state;
+		}
+
+#ifdef _WIN32
+		class win32_source_t : public source_t
+		{
+		public:
+			bool is_down(const int key) override
+			{
+				return GetAsyncKeyState(key) & 0x8000;
+			}
+
+			key_state_t snapshot() override
+			{
+				// there is no batched GetAsyncKeyState, this only saves the virtual call per key
+				key_state_t state;
+				for (int key = 1; key < KEY_COUNT; ++key)
+				{
+					if (GetAsyncKeyState(key) & 0x8000)
+						state.set(key);
+				}
+				return state;
+			}
+
+			std::string key_name(const int key) override
+			{
+				switch (key) {
+				case vk::MBUTTON: case vk::LBUTTON: case vk::RBUTTON: case vk::CONTROL:
+				case vk::MENU: case vk::SHIFT: case vk::CAPITAL: case vk::NUMLOCK: case vk::SCROLL:
+					return default_key_name(key);
+				default: break;
+				}
+				UINT scancode = MapVirtualKey(key, MAPVK_VK_TO_VSC);
+				char key_name[50];
+				int result = GetKeyNameTextA(scancode << 16, key_name, sizeof(key_name));
+				if (result > 0)
+					return key_name;
+				return "Unknown Key: " + std::to_string(key);
+			}
+
+			win32_source_t()
+			{
+				// GetAsyncKeyState has no events, so polling runs on a high resolution timer where
+				// available instead of Sleep and its 15.6ms default granularity
+				m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+				if (!m_timer)
+					m_timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+				m_interrupt = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+			}
+
+			~win32_source_t() override
+			{
+				if (m_timer)
+					CloseHandle(m_timer);
+				if (m_interrupt)
+					CloseHandle(m_interrupt);
+			}
+
+			void wait(const std::chrono::milliseconds duration) override
+			{
+				Sleep(static_cast<DWORD>(duration.count()));
+			}
+
+			bool wait_for_change() override
+			{
+				if (!m_timer || !m_interrupt)
+					return source_t::wait_for_change();
+
+				LARGE_INTEGER due;
+				due.QuadPart = -std::chrono::duration_cast<std::chrono::duration<LONGLONG, std::ratio<1, 10000000>>>(POLL_INTERVAL).count();
+				SetWaitableTimer(m_timer, &due, 0, nullptr, nullptr, FALSE);
+
+				const HANDLE handles[2] = { m_interrupt, m_timer };
+				const DWORD result = WaitForMultipleObjects(2, handles, FALSE, INFINITE);
+				m_last_change = std::chrono::steady_clock::now();
+				return result == WAIT_OBJECT_0 + 1;
+			}
+
+			void interrupt() override
+			{
+				if (m_interrupt)
+					SetEvent(m_interrupt);
+				else
+					source_t::interrupt();
+			}
+
+		private:
+			HANDLE m_timer = nullptr;
+			HANDLE m_interrupt = nullptr;
+		};
+#endif
+
+#ifdef __linux__
+		// evdev key code to virtual key code, 0 for keys without one
+		int to_vk(const uint16_t code)
+		{
+			static const std::array<uint8_t, KEY_CNT> table = [] {
+				std::array<uint8_t, KEY_CNT> vks{};
+				const uint16_t letters[26] = { KEY_A, KEY_B, KEY_C, KEY_D, KEY_E, KEY_F, KEY_G, KEY_H, KEY_I, KEY_J, KEY_K, KEY_L, KEY_M,
+					KEY_N, KEY_O, KEY_P, KEY_Q, KEY_R, KEY_S, KEY_T, KEY_U, KEY_V, KEY_W, KEY_X, KEY_Y, KEY_Z };
+				for (int i = 0; i < 26; ++i)
+					vks[letters[i]] = static_cast<uint8_t>(vk::LETTER_A + i);
+
+				const uint16_t digits[10] = { KEY_0, KEY_1, KEY_2, KEY_3, KEY_4, KEY_5, KEY_6, KEY_7, KEY_8, KEY_9 };
+				const uint16_t numpad[10] = { KEY_KP0, KEY_KP1, KEY_KP2, KEY_KP3, KEY_KP4, KEY_KP5, KEY_KP6, KEY_KP7, KEY_KP8, KEY_KP9 };
+				for (int i = 0; i < 10; ++i)
+				{
+					vks[digits[i]] = static_cast<uint8_t>(vk::DIGIT_0 + i);
+					vks[numpad[i]] = static_cast<uint8_t>(vk::NUMPAD0 + i);
+				}
+
+				const uint16_t functions[12] = { KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6, KEY_F7, KEY_F8, KEY_F9, KEY_F10, KEY_F11, KEY_F12 };
+				for (int i = 0; i < 12; ++i)
+					vks[functions[i]] = static_cast<uint8_t>(vk::F1 + i);
+
+				const std::pair<uint16_t, int> others[] = {
+					{ BTN_LEFT, vk::LBUTTON }, { BTN_RIGHT, vk::RBUTTON }, { BTN_MIDDLE, vk::MBUTTON },
+					{ BTN_SIDE, vk::XBUTTON1 }, { BTN_EXTRA, vk::XBUTTON2 },
+					{ KEY_BACKSPACE, vk::BACK }, { KEY_TAB, vk::TAB }, { KEY_ENTER, vk::RETURN }, { KEY_KPENTER, vk::RETURN },
+					{ KEY_PAUSE, vk::PAUSE }, { KEY_CAPSLOCK, vk::CAPITAL }, { KEY_ESC, vk::ESCAPE }, { KEY_SPACE, vk::SPACE },
+					{ KEY_PAGEUP, vk::PRIOR }, { KEY_PAGEDOWN, vk::NEXT }, { KEY_END, vk::END }, { KEY_HOME, vk::HOME },
+					{ KEY_LEFT, vk::LEFT }, { KEY_UP, vk::UP }, { KEY_RIGHT, vk::RIGHT }, { KEY_DOWN, vk::DOWN },
+					{ KEY_INSERT, vk::INSERT }, { KEY_DELETE, vk::DEL }, { KEY_NUMLOCK, vk::NUMLOCK }, { KEY_SCROLLLOCK, vk::SCROLL },
+					{ KEY_LEFTSHIFT, vk::LSHIFT }, { KEY_RIGHTSHIFT, vk::RSHIFT }, { KEY_LEFTCTRL, vk::LCONTROL },
+					{ KEY_RIGHTCTRL, vk::RCONTROL }, { KEY_LEFTALT, vk::LMENU }, { KEY_RIGHTALT, vk::RMENU },
+				};
+				for (const auto& [code, key] : others)
+					vks[code] = static_cast<uint8_t>(key);
+				return vks;
+			}();
+			return code < table.size() ? table[code] : 0;
+		}
+
+		class evdev_source_t : public source_t
+		{
+		public:
+			explicit evdev_source_t(std::vector<int> fds)
+				: m_fds(std::move(fds)), m_interrupt(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+			{
+				// keys already held when the source is created
+				for (const int fd : m_fds)
+				{
+					int clock = CLOCK_MONOTONIC; // event times on the clock steady_clock uses
+					ioctl(fd, EVIOCSCLOCKID, &clock);
+
+					uint8_t keys[KEY_CNT / 8 + 1]{};
+					if (ioctl(fd, EVIOCGKEY(sizeof(keys)), keys) < 0)
+						continue;
+					for (int code = 0; code < KEY_CNT; ++code)
+					{
+						if ((keys[code / 8] >> (code % 8)) & 1)
+							set(code, true);
+					}
+				}
+			}
+
+			~evdev_source_t() override
+			{
+				for (const int fd : m_fds)
+					close(fd);
+				if (m_interrupt >= 0)
+					close(m_interrupt);
+			}
+
+			bool is_down(const int key) override
+			{
+				if (key <= 0 || key >= KEY_COUNT)
+					return false;
+
+				std::lock_guard lock(m_mutex);
+				pump();
+				return is_down_either(key, m_down);
+			}
+
+			key_state_t snapshot() override
+			{
+				std::lock_guard lock(m_mutex);
+				pump();
+				return with_generic_modifiers(m_down);
+			}
+
+			void wait(const std::chrono::milliseconds duration) override
+			{
+				// sleeps on the devices, so events are taken in as they arrive
+				std::vector<pollfd> fds;
+				{
+					std::lock_guard lock(m_mutex);
+					for (const int fd : m_fds)
+						fds.push_back(pollfd{ fd, POLLIN, 0 });
+				}
+
+				const auto until = std::chrono::steady_clock::now() + duration;
+				for (auto now = std::chrono::steady_clock::now(); now < until; now = std::chrono::steady_clock::now())
+				{
+					const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(until - now);
+					if (::poll(fds.data(), fds.size(), static_cast<int>(std::max<int64_t>(left.count(), 1))) <= 0)
+						break;
+
+					std::lock_guard lock(m_mutex);
+					pump();
+				}
+			}
+
+			bool wait_for_change() override
+			{
+				std::vector<pollfd> fds;
+				{
+					std::lock_guard lock(m_mutex);
+					for (const int fd : m_fds)
+						fds.push_back(pollfd{ fd, POLLIN, 0 });
+				}
+				fds.push_back(pollfd{ m_interrupt, POLLIN, 0 });
+
+				while (true)
+				{
+					if (::poll(fds.data(), fds.size(), -1) < 0)
+					{
+						if (errno == EINTR)
+							continue;
+						return false;
+					}
+
+					if (fds.back().revents & POLLIN)
+					{
+						uint64_t count;
+						(void)!read(m_interrupt, &count, sizeof(count));
+						return false;
+					}
+
+					std::lock_guard lock(m_mutex);
+					// an unplugged or failed device keeps reporting, poll would return right away forever
+					const auto dead = std::remove_if(fds.begin(), fds.end() - 1, [this](const pollfd& pfd) {
+						if (!(pfd.revents & (POLLHUP | POLLERR | POLLNVAL)))
+							return false;
+						close(pfd.fd);
+						std::erase(m_fds, pfd.fd);
+						return true;
+					});
+					fds.erase(dead, fds.end() - 1);
+					if (m_fds.empty())
+						return false;
+
+					if (pump())
+						return true; // only key changes wake the caller, not motion or repeats
+				}
+			}
+
+			void interrupt() override
+			{
+				const uint64_t one = 1;
+				(void)!write(m_interrupt, &one, sizeof(one));
+			}
+
+			std::chrono::steady_clock::time_point last_change_time() override
+			{
+				std::lock_guard lock(m_mutex);
+				return m_last_change;
+			}
+
+		private:
+			bool set(const int code, const bool down)
+			{
+				const int key = to_vk(static_cast<uint16_t>(code));
+				if (!key || m_down.test(key) == down)
+					return false;
+
+				m_down.set(key, down);
+				return true;
+			}
+
+			// Reads every pending event, returns whether a key changed
+			bool pump()
+			{
+				bool changed = false;
+				input_event events[64];
+				for (const int fd : m_fds)
+				{
+					ssize_t len;
+					while ((len = read(fd, events, sizeof(events))) > 0)
+					{
+						for (size_t i = 0; i < static_cast<size_t>(len) / sizeof(input_event); ++i)
+						{
+							const auto& event = events[i];
+							if (event.type != EV_KEY || !set(event.code, event.value != 0)) // 2 is autorepeat, still held
+								continue;
+
+							changed = true;
+							m_last_change = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+								std::chrono::seconds(event.input_event_sec) + std::chrono::microseconds(event.input_event_usec)));
+						}
+					}
+				}
+				return changed;
+			}
+
+			std::mutex m_mutex;
+			std::vector<int> m_fds;
+			int m_interrupt;
+			key_state_t m_down;
+		};
+#endif
+
+		std::mutex source_mutex;
+		std::shared_ptr<source_t> current_source;
+
+		// Names of one source with the reverse lookup, views of codes point into names
+		struct key_names_t
+		{
+			std::array<std::string, KEY_COUNT> names;
+			std::unordered_map<std::string_view, int> codes;
+		};
+
+		// Tables are never freed, references from get_key_name stay valid after set_source
+		std::atomic<const key_names_t*> current_names{ nullptr };
+		std::vector<std::unique_ptr<key_names_t>> built_names; // guarded by source_mutex
+
+		std::shared_ptr<source_t> make_default_source()
+		{
+#ifdef _WIN32
+			return make_win32_source();
+#else
+#ifdef __linux__
+			if (auto source = make_evdev_source())
+				return source;
+#endif
+			return std::make_shared<null_source_t>();
+#endif
+		}
+	}
+
+#ifdef _WIN32
+	std::shared_ptr<source_t> make_win32_source()
+	{
+		return std::make_shared<win32_source_t>();
+	}
+#endif
+
+#ifdef __linux__
+	std::shared_ptr<source_t> make_evdev_source(const std::vector<std::string>& devices)
+	{
+		std::vector<std::string> paths = devices;
+		if (paths.empty())
+		{
+			std::error_code err;
+			for (const auto& entry : std::filesystem::directory_iterator("/dev/input", err))
+			{
+				if (entry.path().filename().string().starts_with("event"))
+					paths.push_back(entry.path().string());
+			}
+		}
+
+		std::vector<int> fds;
+		for (const auto& path : paths)
+		{
+			const int fd = open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+			if (fd < 0)
+				continue;
+
+			unsigned long types = 0;
+			if (ioctl(fd, EVIOCGBIT(0, sizeof(types)), &types) < 0 || !(types & (1ul << EV_KEY)))
+			{
+				close(fd);
+				continue;
+			}
+			fds.push_back(fd);
+		}
+
+		if (fds.empty())
+			return nullptr;
+		return std::make_shared<evdev_source_t>(std::move(fds));
+	}
+#endif
+
+	void set_source(std::shared_ptr<source_t> source)
+	{
+		std::lock_guard lock(source_mutex);
+		current_source = source ? std::move(source) : make_default_source();
+		current_names.store(nullptr, std::memory_order_release); // the next lookup builds the table of the new source
+	}
+
+	std::shared_ptr<source_t> get_source()
+	{
+		std::lock_guard lock(source_mutex);
+		if (!current_source)
+			current_source = make_default_source();
+		return current_source;
+	}
+
+	namespace
+	{
+		const key_names_t& get_names()
+		{
+			if (const auto* names = current_names.load(std::memory_order_acquire))
+				return *names;
+
+			// platform names cost a MapVirtualKey and GetKeyNameTextA each, so every code is resolved once per source
+			std::lock_guard lock(source_mutex);
+			if (const auto* names = current_names.load(std::memory_order_acquire))
+				return *names;
+			if (!current_source)
+				current_source = make_default_source();
+
+			auto table = std::make_unique<key_names_t>();
+			for (int code = 0; code < KEY_COUNT; ++code)
+			{
+				table->names[code] = current_source->key_name(code);
+				if (!table->names[code].empty() && !table->names[code].starts_with("Unknown Key"))
+					table->codes.try_emplace(table->names[code], code); // the lowest code keeps a shared name
+			}
+			current_names.store(table.get(), std::memory_order_release);
+			return *built_names.emplace_back(std::move(table));
+		}
+	}
+
+	const std::string& get_key_name(const int key)
+	{
+		static const std::string unknown = "Unknown Key";
+		return static_cast<unsigned>(key) < KEY_COUNT ? get_names().names[key] : unknown;
+	}
+
+	int find_key_code(const std::string_view name)
+	{
+		const auto& codes = get_names().codes;
+		const auto it = codes.find(name);
+		return it == codes.end() ? -1 : it->second;
+	}
+
+	replay_source_t::replay_source_t(std::vector<event_t> script)
+	{
+		for (const auto& event : script)
+			schedule(event);
+	}
+
+	std::shared_ptr<replay_source_t> replay_source_t::parse(const std::string_view text)
+	{
+		auto source = std::make_shared<replay_source_t>();
+		size_t pos = 0;
+		while (pos < text.size())
+		{
+			size_t end = text.find('\n', pos);
+			if (end == std::string_view::npos)
+				end = text.size();
+			std::string_view line = text.substr(pos, end - pos);
+			pos = end + 1;
+
+			line = line.substr(0, line.find('#'));
+			std::string_view fields[3];
+			size_t count = 0;
+			for (size_t start = line.find_first_not_of(" \t\r"); start != std::string_view::npos; start = line.find_first_not_of(" \t\r", start))
+			{
+				const size_t stop = std::min(line.find_first_of(" \t\r", start), line.size());
+				if (count == 3)
+					return nullptr;
+				fields[count++] = line.substr(start, stop - start);
+				start = stop;
+			}
+
+			if (count == 0)
+				continue;
+
+			int64_t time;
+			int key;
+			if (count != 3 || !shared::num::parse(fields[0], time) || !shared::num::parse(fields[1], key) ||
+				key <= 0 || key >= KEY_COUNT || (fields[2] != "down" && fields[2] != "up"))
+				return nullptr;
+
+			source->schedule(event_t{ std::chrono::milliseconds(time), key, fields[2] == "down" });
+		}
+		return source;
+	}
+
+	bool replay_source_t::is_down(const int key)
+	{
+		std::lock_guard lock(m_mutex);
+		return key > 0 && key < KEY_COUNT && is_down_either(key, m_down);
+	}
+
+	key_state_t replay_source_t::snapshot()
+	{
+		std::lock_guard lock(m_mutex);
+		return with_generic_modifiers(m_down);
+	}
+
+	void replay_source_t::wait(const std::chrono::milliseconds duration)
+	{
+		advance(duration);
+	}
+
+	bool replay_source_t::wait_for_change()
+	{
+		std::unique_lock lock(m_mutex);
+		m_wake.wait(lock, [this] { return m_interrupted.load() || m_next < m_script.size(); });
+		if (m_interrupted.exchange(false))
+			return false;
+
+		m_now = std::max(m_now, m_script[m_next].time);
+		for (; m_next < m_script.size() && m_script[m_next].time <= m_now; ++m_next)
+			m_down.set(m_script[m_next].key, m_script[m_next].down);
+		m_last_change = std::chrono::steady_clock::now();
+		return true;
+	}
+
+	void replay_source_t::interrupt()
+	{
+		{
+			std::lock_guard lock(m_mutex);
+			m_interrupted = true;
+		}
+		m_wake.notify_all();
+	}
+
+	void replay_source_t::schedule(const event_t event)
+	{
+		std::lock_guard lock(m_mutex);
+		if (event.key <= 0 || event.key >= KEY_COUNT)
+			return;
+
+		if (event.time <= m_now)
+		{
+			m_down.set(event.key, event.down);
+			return;
+		}
+
+		// stable, so events at the same time apply in the order they were scheduled
+		const auto pos = std::upper_bound(m_script.begin() + m_next, m_script.end(), event,
+			[](const event_t& lhs, const event_t& rhs) { return lhs.time < rhs.time; });
+		m_script.insert(pos, event);
+		m_wake.notify_all();
+	}
+
+	void replay_source_t::set(const int key, const bool down)
+	{
+		std::lock_guard lock(m_mutex);
+		if (key > 0 && key < KEY_COUNT)
+			m_down.set(key, down);
+	}
+
+	void replay_source_t::advance(const std::chrono::milliseconds duration)
+	{
+		std::lock_guard lock(m_mutex);
+		m_now += duration;
+		for (; m_next < m_script.size() && m_script[m_next].time <= m_now; ++m_next)
+			m_down.set(m_script[m_next].key, m_script[m_next].down);
+	}
+
+	std::chrono::milliseconds replay_source_t::now() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_now;
+	}
+
+	bool replay_source_t::finished() const
+	{
+		std::lock_guard lock(m_mutex);
+		return m_next == m_script.size();
+	}
+}
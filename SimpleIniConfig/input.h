@@ -0,0 +1,340 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Keyboard and mouse state behind an exchangeable source, so keybinds run on Win32, on Linux
+// through evdev and headless from a script.
+namespace input
+{
+	// Virtual key codes, the values are the Win32 ones so existing configs keep their meaning
+	namespace vk
+	{
+		constexpr int LBUTTON = 0x01;
+		constexpr int RBUTTON = 0x02;
+		constexpr int MBUTTON = 0x04;
+		constexpr int XBUTTON1 = 0x05;
+		constexpr int XBUTTON2 = 0x06;
+		constexpr int BACK = 0x08;
+		constexpr int TAB = 0x09;
+		constexpr int RETURN = 0x0D;
+		constexpr int SHIFT = 0x10;
+		constexpr int CONTROL = 0x11;
+		constexpr int MENU = 0x12; // alt
+		constexpr int PAUSE = 0x13;
+		constexpr int CAPITAL = 0x14;
+		constexpr int ESCAPE = 0x1B;
+		constexpr int SPACE = 0x20;
+		constexpr int PRIOR = 0x21;
+		constexpr int NEXT = 0x22;
+		constexpr int END = 0x23;
+		constexpr int HOME = 0x24;
+		constexpr int LEFT = 0x25;
+		constexpr int UP = 0x26;
+		constexpr int RIGHT = 0x27;
+		constexpr int DOWN = 0x28;
+		constexpr int INSERT = 0x2D;
+		constexpr int DEL = 0x2E;
+		constexpr int DIGIT_0 = 0x30; // '0' to '9'
+		constexpr int LETTER_A = 0x41; // 'A' to 'Z'
+		constexpr int NUMPAD0 = 0x60; // to NUMPAD9 at 0x69
+		constexpr int F1 = 0x70; // to F24 at 0x87
+		constexpr int NUMLOCK = 0x90;
+		constexpr int SCROLL = 0x91;
+		constexpr int LSHIFT = 0xA0;
+		constexpr int RSHIFT = 0xA1;
+		constexpr int LCONTROL = 0xA2;
+		constexpr int RCONTROL = 0xA3;
+		constexpr int LMENU = 0xA4;
+		constexpr int RMENU = 0xA5;
+	}
+
+	constexpr int KEY_COUNT = 256;
+
+	/// <summary>
+	/// Held state of every virtual key as one 256 bit set. Operators work on whole 64 bit words,
+	/// so comparing two snapshots costs a handful of instructions however many keys are bound.
+	/// </summary>
+	struct key_state_t
+	{
+		static constexpr int WORDS = KEY_COUNT / 64;
+
+		alignas(32) std::array<uint64_t, WORDS> m_words{};
+
+		bool test(const int key) const
+		{
+			return static_cast<unsigned>(key) < KEY_COUNT && ((m_words[key >> 6] >> (key & 63)) & 1);
+		}
+
+		void set(const int key, const bool down = true)
+		{
+			if (static_cast<unsigned>(key) >= KEY_COUNT)
+				return;
+			const uint64_t bit = uint64_t(1) << (key & 63);
+			m_words[key >> 6] = down ? (m_words[key >> 6] | bit) : (m_words[key >> 6] & ~bit);
+		}
+
+		bool any() const
+		{
+			uint64_t merged = 0;
+			for (const uint64_t word : m_words)
+				merged |= word;
+			return merged != 0;
+		}
+
+		/// <summary>
+		/// Lowest key that is set, -1 if none
+		/// </summary>
+		int first() const
+		{
+			for (int i = 0; i < WORDS; ++i)
+			{
+				if (m_words[i])
+					return i * 64 + std::countr_zero(m_words[i]);
+			}
+			return -1;
+		}
+
+		/// <summary>
+		/// Calls fn(key) for every key that is set, in ascending order
+		/// </summary>
+		template< typename fn_t >
+		void for_each(fn_t&& fn) const
+		{
+			for (int i = 0; i < WORDS; ++i)
+			{
+				for (uint64_t word = m_words[i]; word; word &= word - 1)
+					fn(i * 64 + std::countr_zero(word));
+			}
+		}
+
+		friend key_state_t operator&(const key_state_t& lhs, const key_state_t& rhs)
+		{
+			key_state_t out;
+			for (int i = 0; i < WORDS; ++i)
+				out.m_words[i] = lhs.m_words[i] & rhs.m_words[i];
+			return out;
+		}
+
+		friend key_state_t operator|(const key_state_t& lhs, const key_state_t& rhs)
+		{
+			key_state_t out;
+			for (int i = 0; i < WORDS; ++i)
+				out.m_words[i] = lhs.m_words[i] | rhs.m_words[i];
+			return out;
+		}
+
+		friend key_state_t operator^(const key_state_t& lhs, const key_state_t& rhs)
+		{
+			key_state_t out;
+			for (int i = 0; i < WORDS; ++i)
+				out.m_words[i] = lhs.m_words[i] ^ rhs.m_words[i];
+			return out;
+		}
+
+		friend key_state_t operator~(const key_state_t& state)
+		{
+			key_state_t out;
+			for (int i = 0; i < WORDS; ++i)
+				out.m_words[i] = ~state.m_words[i];
+			return out;
+		}
+
+		friend bool operator==(const key_state_t&, const key_state_t&) = default;
+	};
+
+	/// <summary>
+	/// Keys that went down and keys that went up between two snapshots
+	/// </summary>
+	struct key_edges_t
+	{
+		key_state_t pressed;
+		key_state_t released;
+	};
+
+	inline key_edges_t get_edges(const key_state_t& previous, const key_state_t& current)
+	{
+		const key_state_t changed = previous ^ current;
+		return key_edges_t{ changed & current, changed & previous };
+	}
+
+	/// <summary>
+	/// Where key states come from. Sources are polled from the keybind thread only.
+	/// </summary>
+	class source_t
+	{
+	public:
+		virtual ~source_t() = default;
+
+		/// <summary>
+		/// Is the key held right now
+		/// </summary>
+		/// <param name="key">Virtual key code</param>
+		virtual bool is_down(const int key) = 0;
+
+		/// <summary>
+		/// Every held key in one call, generic modifiers such as SHIFT included
+		/// </summary>
+		virtual key_state_t snapshot();
+
+		/// <summary>
+		/// Lowest virtual key code that is held, -1 if none
+		/// </summary>
+		int first_down();
+
+		/// <summary>
+		/// Display name of a key, e.g. "F1" or "Middle Mouse Button"
+		/// </summary>
+		/// <param name="key">Virtual key code</param>
+		virtual std::string key_name(const int key);
+
+		/// <summary>
+		/// Pauses between two polls, scripted sources advance their clock instead of sleeping
+		/// </summary>
+		virtual void wait(const std::chrono::milliseconds duration);
+
+		/// <summary>
+		/// Blocks until key states may have changed. Event based sources wake on input events,
+		/// the others after one tick of POLL_INTERVAL.
+		/// </summary>
+		/// <returns>False when woken by interrupt()</returns>
+		virtual bool wait_for_change();
+
+		/// <summary>
+		/// Wakes wait_for_change from another thread, the next wait returns false if nobody is waiting
+		/// </summary>
+		virtual void interrupt();
+
+		/// <summary>
+		/// When the latest change was seen, the kernel event time for evdev and the wake up time otherwise
+		/// </summary>
+		virtual std::chrono::steady_clock::time_point last_change_time();
+
+		static constexpr std::chrono::milliseconds POLL_INTERVAL{ 1 };
+
+	protected:
+		std::atomic<bool> m_interrupted = false;
+		std::chrono::steady_clock::time_point m_last_change;
+	};
+
+	/// <summary>
+	/// Replaces the source used by keybinds
+	/// </summary>
+	/// <param name="source">New source, nullptr restores the platform default</param>
+	void set_source(std::shared_ptr<source_t> source);
+
+	/// <summary>
+	/// Gets the source used by keybinds, the platform default until set_source is called:
+	/// GetAsyncKeyState on Windows, evdev on Linux and a source with no keys held elsewhere.
+	/// The returned pointer keeps the source alive when set_source replaces it meanwhile.
+	/// </summary>
+	std::shared_ptr<source_t> get_source();
+
+	/// <summary>
+	/// Name of a key without asking the platform, used by sources that have no names of their own
+	/// </summary>
+	/// <param name="key">Virtual key code</param>
+	std::string default_key_name(const int key);
+
+	/// <summary>
+	/// Name of a key from a table built from the current source at the first lookup and again at
+	/// the first lookup after set_source. Tables are kept, the reference stays valid for the
+	/// lifetime of the process.
+	/// </summary>
+	/// <param name="key">Virtual key code</param>
+	const std::string& get_key_name(const int key);
+
+	/// <summary>
+	/// Reverse of get_key_name on the same table, e.g. "F1" to vk::F1
+	/// </summary>
+	/// <param name="name">Key name as returned by get_key_name</param>
+	/// <returns>Virtual key code, -1 if no key has that name</returns>
+	int find_key_code(const std::string_view name);
+
+#ifdef _WIN32
+	std::shared_ptr<source_t> make_win32_source();
+#endif
+
+#ifdef __linux__
+	/// <summary>
+	/// Reads key and button events from /dev/input. Needs read access to the event devices,
+	/// usually membership of the input group.
+	/// </summary>
+	/// <param name="devices">Event devices to read, every /dev/input/event* that reports keys when empty</param>
+	/// <returns>Source or nullptr if no device could be opened</returns>
+	std::shared_ptr<source_t> make_evdev_source(const std::vector<std::string>& devices = {});
+#endif
+
+	/// <summary>
+	/// Deterministic source for tests and benchmarks. Key changes are scheduled on a virtual clock
+	/// that only moves through wait() and advance(), so a script replays the same way every run.
+	/// </summary>
+	class replay_source_t : public source_t
+	{
+	public:
+		struct event_t
+		{
+			std::chrono::milliseconds time; // since the start of the script
+			int key;
+			bool down;
+		};
+
+		replay_source_t() = default;
+		explicit replay_source_t(std::vector<event_t> script);
+
+		/// <summary>
+		/// Parses a script of "time_ms key down|up" lines, '#' starts a comment
+		/// </summary>
+		/// <param name="text">Script text</param>
+		/// <returns>Source or nullptr if a line is invalid</returns>
+		static std::shared_ptr<replay_source_t> parse(const std::string_view text);
+
+		bool is_down(const int key) override;
+		key_state_t snapshot() override;
+		void wait(const std::chrono::milliseconds duration) override;
+
+		/// <summary>
+		/// Moves the virtual clock straight to the next scheduled event, blocks while there is none
+		/// </summary>
+		bool wait_for_change() override;
+		void interrupt() override;
+
+		/// <summary>
+		/// Schedules a key change, events may be added in any order
+		/// </summary>
+		void schedule(const event_t event);
+
+		/// <summary>
+		/// Changes a key right away
+		/// </summary>
+		void set(const int key, const bool down);
+
+		/// <summary>
+		/// Moves the virtual clock forward and applies every event that became due
+		/// </summary>
+		void advance(const std::chrono::milliseconds duration);
+
+		std::chrono::milliseconds now() const;
+
+		/// <summary>
+		/// Has every scheduled event been applied
+		/// </summary>
+		bool finished() const;
+
+	private:
+		mutable std::mutex m_mutex;
+		std::condition_variable m_wake;
+		key_state_t m_down;
+		std::vector<event_t> m_script; // sorted by time
+		size_t m_next = 0;
+		std::chrono::milliseconds m_now{ 0 };
+	};
+}
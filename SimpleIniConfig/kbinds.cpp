@@ -1,45 +1,42 @@
 #include "kbinds.h"
-AmiKeyBind aimKeyBind(VK_MBUTTON);
-AmiKeyBind triggerKeyBind(VK_RBUTTON);
+#include "config.h"
+#include "log.h"
+#include "numconv.h"
+#include "observer.h"
+#include "snapshot.h"
+#include "stats.h"
+#include <algorithm>
+#include <array>
+AmiKeyBind aimKeyBind(input::vk::MBUTTON);
+AmiKeyBind triggerKeyBind(input::vk::RBUTTON);
 KeyBindManager keyBindManager;
 MenuAndKeyData gMenuKeyData;
 
 MenuAndKeyData LoadMenuAndKeyNames(const std::string& filename) {
     MenuAndKeyData result;
-    ini::INIParser parser;
-    std::ifstream inFile(filename);
+    ini::FlatINIParser parser;
+    ini::MappedFile inFile(filename);
     if (!inFile.is_open()) {
-#ifdef DEBUGLOG
-        std::ofstream logFile;
-        logFile.open("loadlog.txt", std::ios_base::app);
-        logFile << "Error: Unable to open file : " << filename << std::endl;
-        logFile.close();
-#endif
+        CONFIG_LOG(error, "Unable to open file: ", filename);
         return result;  // Return empty result
     }
 
-    std::stringstream buffer;
-    buffer << inFile.rdbuf();
-    parser.parse(buffer.str(), true);
-    inFile.close();
+    config::stats::add(config::stats::BYTES_READ, inFile.view().size());
+    parser.parse(inFile.view(), true);
 
-    for (const auto& section : parser.sections) {
-        const auto& sectionName = section.first;
-        const auto& keyValueMap = section.second;
+    for (const auto& record : parser.records) {
+        int code;
+        if (!shared::num::parse(record.value, code)) {
+            continue; // Not a number, skip
+        }
 
-        if (sectionName == "KeyNames") {
+        if (record.section == "KeyNames") {
             // Handle the KeyNames section differently
-            for (const auto& kv : keyValueMap) {
-                result.keyNames[kv.first] = std::stoi(kv.second);
-            }
+            result.keyNames[std::string(record.key)] = code;
         }
         else {
             // For other sections, create a map of menu items indexed by integer
-            std::map<int, std::string> menuItems;
-            for (const auto& kv : keyValueMap) {
-                menuItems[std::stoi(kv.second)] = kv.first;
-            }
-            result.menuData[sectionName] = menuItems;
+            result.menuData[std::string(record.section)][code] = std::string(record.key);
         }
     }
     return result;
@@ -48,6 +45,20 @@ MenuAndKeyData LoadMenuAndKeyNames(const std::string& filename) {
 
 
 
+// Commands resolved once per load, a press only assigns the stored values
+struct FkeyBinds::BindTable {
+    struct Action {
+        uint32_t item;
+        Command::ActionType action;
+        config::value_t value; // parsed at load time, already of the item type
+        const config::codec_t* codec;
+        std::string text; // parsed again on press for std::any items whose codec cannot assign in place
+    };
+
+    std::array<std::vector<Action>, input::KEY_COUNT> actions;
+    input::key_state_t bound; // key codes with actions
+};
+
 FkeyBinds::FkeyBinds(const std::string& filepath) {
     loadKeyBinds(filepath);
 }
@@ -59,74 +70,114 @@ FkeyBinds::FkeyBinds() {
 bool FkeyBinds::loadKeyBinds(const std::string& filepath) {
 
     if (!std::filesystem::is_regular_file(filepath)) {
-#ifdef DEBUGLOG
-        std::cerr << "Config path is not a regular file." << std::endl;
-#endif
+        CONFIG_LOG(error, "Config path is not a regular file: ", filepath);
         return false;
     }
 
     if (!std::filesystem::exists(filepath)) {
-#ifdef DEBUGLOG
-        std::cerr << "Config file doesn't exist." << std::endl;
-#endif
+        CONFIG_LOG(error, "Config file doesn't exist: ", filepath);
         return false;
     }
 
-    ini::INIParser parser;
-    std::ifstream config_file(filepath, std::ios::in);
+    ini::FlatINIParser parser;
+    ini::MappedFile config_file(filepath);
     if (!config_file.is_open()) {
-#ifdef DEBUGLOG
-        std::cerr << "Error opening the config file." << std::endl;
-#endif
+        CONFIG_LOG(error, "Error opening the config file ", filepath);
         return false;
     }
 
-    std::string content((std::istreambuf_iterator<char>(config_file)),
-        std::istreambuf_iterator<char>());
-
-    parser.parse(content, false);
-    // Fetching the "KeyBinds" section and populating the keybinds map
-    auto& keyBindsSection = parser.sections["KeyBinds"];
-    auto& hotKey = parser.sections["KeyBinder"]["HotKey"];
+    config::stats::add(config::stats::BYTES_READ, config_file.view().size());
+    parser.parse(config_file.view(), false);
+    auto hotKey = parser.get("KeyBinder", "HotKey");
 
     // Searching for HotKey
-    auto hotKeyMatch = std::find_if(gMenuKeyData.keyNames.begin(), gMenuKeyData.keyNames.end(),
-        [&](const std::pair<std::string, int>& entry) {
-            return entry.first == hotKey;
-        });
-
-    if (hotKeyMatch == gMenuKeyData.keyNames.end()) {
-#ifdef DEBUGLOG
-        std::cerr << "Invalid HotKey specified in the config file." << std::endl;
-#endif
+    const int hotKeyCode = gMenuKeyData.findKeyCode(hotKey);
+    if (hotKeyCode < 0) {
+        CONFIG_LOG(warning, "Invalid HotKey specified in the config file.");
     }
     else {
-        int hotKeyCode = hotKeyMatch->second;
+        std::lock_guard lock(pendingMutex);
         hotkey = hotKeyCode;
     }
 
-    // Processing keyBindsSection
-    for (const auto& [keyName, command] : keyBindsSection) {
-        auto keyMatch = std::find_if(gMenuKeyData.keyNames.begin(), gMenuKeyData.keyNames.end(),
-            [&](const std::pair<std::string, int>& entry) {
-                return entry.first == keyName;
-            });
-
-        if (keyMatch == gMenuKeyData.keyNames.end()) {
-#ifdef DEBUGLOG
-            std::cerr << "Invalid key specified for bind: " << keyName << std::endl;
-#endif
-            continue;
+    // Fetching the "KeyBinds" section and populating the keybinds map
+    parser.for_each_in_section("KeyBinds", [&](std::string_view keyName, std::string_view command) {
+        if (gMenuKeyData.findKeyCode(keyName) < 0) {
+            CONFIG_LOG(warning, "Invalid key specified for bind: ", keyName);
+            return;
         }
 
         if (command.empty()) {
+            return;
+        }
+
+        keybinds[std::string(keyName)] = std::string(command);
+    });
+
+    compileBinds();
+    return true;
+}
+
+void FkeyBinds::compileBinds() {
+    auto table = std::make_shared<BindTable>();
+    for (const auto& [keyName, bind] : keybinds) {
+        const int keyCode = gMenuKeyData.findKeyCode(keyName);
+        if (keyCode <= 0 || keyCode >= input::KEY_COUNT) {
+            CONFIG_LOG(warning, "Invalid key specified for bind: ", keyName);
             continue;
         }
+        auto& actions = table->actions[keyCode];
+
+        std::stringstream ss(bind);
+        std::string commandString;
+        while (std::getline(ss, commandString, '|')) {
+            Command cmd = Command::parse(commandString);
+            if (cmd.action == Command::ActionType::Invalid) continue;
+
+            int itemIndex = config::does_item_exist(cmd.sectionName, cmd.valueName);
+            if (itemIndex < 0) {
+                CONFIG_LOG(warning, "Invalid item: ", cmd.sectionName, ".", cmd.valueName);
+                continue;
+            }
+            const auto& item = config::get_item(itemIndex);
 
-        keybinds[keyName] = command;
+            const auto* codec = config::find_codec(item.m_type);
+            if (!codec) {
+                config::stats::add(config::stats::PARSE_ERRORS);
+                CONFIG_LOG(warning, "Unhandled item type: ", item.m_type);
+                continue;
+            }
+
+            config::value_t value = item.m_var;
+            if (!codec->parse(cmd.value, value)) {
+                config::stats::add(config::stats::PARSE_ERRORS);
+                CONFIG_LOG(warning, "Invalid value for key ", keyName, ": ", cmd.value);
+                continue;
+            }
+            config::stats::add(config::stats::ITEMS_PARSED);
+
+            const bool byText = std::holds_alternative<std::any>(value) && !codec->assign;
+            actions.push_back(BindTable::Action{ static_cast<uint32_t>(itemIndex), cmd.action, std::move(value), codec, byText ? cmd.value : std::string() });
+        }
     }
 
-    return true;
+    size_t boundKeys = 0;
+    size_t actionCount = 0;
+    for (int key = 0; key < input::KEY_COUNT; ++key) {
+        if (!table->actions[key].empty()) {
+            table->bound.set(key);
+            ++boundKeys;
+            actionCount += table->actions[key].size();
+        }
+    }
+
+    // sized so a press and release of every bound key between two polls never allocates
+    observedChanges.reserve(actionCount);
+    dispatchingKeys.reserve(2 * boundKeys);
+    std::lock_guard lock(pendingMutex); // a running dispatcher switches to the new table at its next check
+    pendingKeys.reserve(2 * boundKeys);
+    bindTable = std::move(table);
+    previousDown = {};
 }
 
 
@@ -164,105 +215,145 @@ std::string FkeyBinds::getActionForBind(const std::string& key, const std::strin
     return "";
 }
 
-int getKeyCodeFromKeyName(const std::string& keyName) {
-    for (const auto& pair : gMenuKeyData.keyNames) {
-        if (pair.first == keyName) {
-            return pair.second;
+void FkeyBinds::checkKeysOnce() {
+    checkKeysOnce(*input::get_source());
+}
+
+void FkeyBinds::checkKeysOnce(input::source_t& source) {
+    const input::key_state_t state = source.snapshot();
+    const auto changeTime = source.last_change_time();
+
+    std::lock_guard lock(pendingMutex);
+    if (!bindTable) {
+        return;
+    }
+    if (hotkey != 1 && !state.test(hotkey)) {
+        return;
+    }
+
+    const input::key_state_t down = state & bindTable->bound;
+    if (down == previousDown) {
+        return;
+    }
+    const input::key_edges_t edges = input::get_edges(previousDown, down);
+    previousDown = down;
+
+    edges.released.for_each([&](int key) {
+        pendingKeys.push_back(PendingKey{ key, Command::ActionType::OnRelease, changeTime });
+    });
+    edges.pressed.for_each([&](int key) {
+        pendingKeys.push_back(PendingKey{ key, Command::ActionType::OnPress, changeTime });
+    });
+}
+
+size_t FkeyBinds::poll() {
+    {
+        std::lock_guard lock(pendingMutex);
+        if (pendingKeys.empty()) {
+            return 0;
         }
+        dispatchingKeys.swap(pendingKeys);
+    }
+
+    bool changed = false;
+    observedChanges.clear();
+    for (const auto& pending : dispatchingKeys) {
+        changed |= executeKey(pending.keyCode, pending.action);
+    }
+
+    if (changed) {
+        config::publish();
     }
-    return -1; // or throw an exception
+    // an item bound to several changed keys is reported once
+    std::sort(observedChanges.begin(), observedChanges.end());
+    observedChanges.erase(std::unique(observedChanges.begin(), observedChanges.end()), observedChanges.end());
+    config::notify(observedChanges);
+
+    const auto now = std::chrono::steady_clock::now();
+    for (const auto& pending : dispatchingKeys) {
+        config::stats::record(config::stats::PHASE_DISPATCH, now - pending.changeTime);
+    }
+    const size_t applied = dispatchingKeys.size();
+    dispatchingKeys.clear();
+    return applied;
 }
 
+// Shared by run and continuousKeyCheck. The source is held for the whole loop, so a set_source
+// meanwhile neither destroys it nor keeps stop() from interrupting it.
+template <typename Tick>
+void FkeyBinds::runLoop(Tick&& tick) {
+    const auto source = input::get_source();
+    {
+        std::lock_guard lock(pendingMutex);
+        runningSource = source;
+    }
+    while (!stopping) {
+        tick(*source);
+        // blocks until the source reports a change, interrupted by stop()
+        source->wait_for_change();
+    }
+    std::lock_guard lock(pendingMutex);
+    runningSource.reset();
+    stopping = false;
+}
 
-void FkeyBinds::executeBind(const std::string& key, Command::ActionType actionType) {
-    auto bind = getBind(key);
-    if (bind.empty()) return;
-
-    std::stringstream ss(bind);
-    std::string commandString;
-    while (std::getline(ss, commandString, '|')) {
-        Command cmd = Command::parse(commandString);
-        if (cmd.action != actionType) continue;
-
-        int itemIndex = config::does_item_exist(cmd.sectionName, cmd.valueName);
-        if (itemIndex < 0) {
-#ifdef DEBUGLOG
-            std::cerr << "Invalid item: " << cmd.sectionName << "." << cmd.valueName << std::endl;
-#endif
-            continue;
-        }
-        auto& item = config::get_item(itemIndex);
+void FkeyBinds::run() {
+    runLoop([this](input::source_t& source) {
+        checkKeysOnce(source);
+    });
+}
 
-        switch (item.m_type) {
-        case CT_HASH("bool"): {
-            bool boolValue = cmd.value == "true" || cmd.value == "True";
-            item.set<bool>(boolValue);
-            break;
-        }
-        case CT_HASH("int"): {
-            int intValue = std::stoi(cmd.value);
-            item.set<int>(intValue);
-            break;
-        }
-        case CT_HASH("float"): {
-            float floatValue = std::stof(cmd.value);
-            item.set<float>(floatValue);
-            break;
-        }
-        case CT_HASH("shared::col_t"): {
-            std::vector<std::string> colorComponents;
-            std::stringstream colorStream(cmd.value);
-            std::string component;
-            while (std::getline(colorStream, component, ',')) {
-                colorComponents.push_back(component);
-            }
+void FkeyBinds::continuousKeyCheck() {
+    runLoop([this](input::source_t& source) {
+        checkKeysOnce(source);
+        poll();
+    });
+}
 
-            if (colorComponents.size() == 4) { // Ensure we have the expected number of components
-                shared::col_t colorValue(
-                    std::stoi(colorComponents[0]),
-                    std::stoi(colorComponents[1]),
-                    std::stoi(colorComponents[2]),
-                    std::stoi(colorComponents[3])
-                );
-                item.set<shared::col_t>(colorValue);
-            }
-            else {
-#ifdef DEBUGLOG
-                std::cerr << "Invalid color format for key " << key << ". Expected 4 components (R, G, B, A), found " << colorComponents.size() << "." << std::endl;
-#endif
-            }
-            break;
-        }
-        case CT_HASH("std::string"): {
-            item.set<std::string>(cmd.value);
-            break;
-        }
-        case CT_HASH("std::vector<int>"): {
-            std::vector<int> intValues;
-            std::stringstream valueStream(cmd.value);
-            std::string segment;
-            while (std::getline(valueStream, segment, ',')) {
-                intValues.push_back(std::stoi(segment));
-            }
-            item.set<std::vector<int>>(intValues);
-            break;
-        }
-        case CT_HASH("std::vector<float>"): {
-            std::vector<float> floatValues;
-            std::stringstream valueStream(cmd.value);
-            std::string segment;
-            while (std::getline(valueStream, segment, ',')) {
-                floatValues.push_back(std::stof(segment));
-            }
-            item.set<std::vector<float>>(floatValues);
-            break;
-        }
-        default:
-#ifdef DEBUGLOG
-            std::cerr << "Unhandled item type: " << item.m_type << std::endl;
-#endif
-            break;
+void FkeyBinds::stop() {
+    std::shared_ptr<input::source_t> source;
+    {
+        // only a running loop is stopped, a flag left set would end the next run() right away
+        std::lock_guard lock(pendingMutex);
+        if (!runningSource) {
+            return;
         }
+        stopping = true;
+        source = runningSource;
+    }
+    source->interrupt();
+}
+
+void FkeyBinds::executeBind(const std::string& key, Command::ActionType actionType) {
+    observedChanges.clear();
+    if (executeKey(gMenuKeyData.findKeyCode(key), actionType)) {
+        config::publish();
     }
+    config::notify(observedChanges);
 }
 
+// Assigns the values bound to a key and collects the observed items in observedChanges,
+// publishing and notifying is left to the caller so a batch of keys does both once
+bool FkeyBinds::executeKey(int keyCode, Command::ActionType actionType) {
+    if (!bindTable || keyCode <= 0 || keyCode >= input::KEY_COUNT) return false;
+
+    config::stats::timer_t timer(config::stats::PHASE_APPLY);
+    bool changed = false;
+    config::value_t scratch;
+    for (const auto& action : bindTable->actions[keyCode]) {
+        if (action.action != actionType) continue;
+
+        auto& item = config::get_item(action.item);
+        if (!std::holds_alternative<std::any>(action.value))
+            item.m_var = action.value; // same alternative, assigned in place
+        else if (action.text.empty())
+            action.codec->assign(action.value, item.m_var);
+        else if (!config::convert_checked(action.codec->parse, action.text, item.m_var, scratch))
+            continue;
+        item.mark_dirty();
+        changed = true;
+        if (item.m_observed)
+            observedChanges.push_back(action.item);
+    }
+    return changed;
+}
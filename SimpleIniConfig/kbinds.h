@@ -1,11 +1,35 @@
 #pragma once
-//#include "Windows.h"
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
 #include "iniconfig.h"
-#include "config.h"
+#include "input.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// Transparent, so key names are looked up by string_view without building a string
+struct KeyNameHash {
+	using is_transparent = void;
+	size_t operator()(std::string_view name) const {
+		return shared::hash::get(name);
+	}
+};
 
 struct MenuAndKeyData {
 	std::map<std::string, std::map<int, std::string>> menuData;
-	std::map<std::string, int> keyNames;
+	std::unordered_map<std::string, int, KeyNameHash, std::equal_to<>> keyNames;
+
+	// Key code for a name from the KeyNames section, falling back to the names AmiKeyBind::toString
+	// shows, -1 if unknown
+	int findKeyCode(std::string_view keyName) const {
+		const auto it = keyNames.find(keyName);
+		return it == keyNames.end() ? input::find_key_code(keyName) : it->second;
+	}
 };
 
 extern MenuAndKeyData gMenuKeyData;
@@ -14,9 +38,7 @@ MenuAndKeyData LoadMenuAndKeyNames(const std::string& filename);
 
 class AmiKeyBind {
 public:
-	explicit AmiKeyBind(int defaultKey = 0) : keyCode(defaultKey), recordNextKeyPress(false) {
-		keyName = GetKeyName(keyCode);
-	}
+	explicit AmiKeyBind(int defaultKey = 0) : keyCode(defaultKey), recordNextKeyPress(false) {}
 
 
 	void startRecording() {
@@ -25,13 +47,17 @@ public:
 
 	void recordKeyPress() {
 		if (recordNextKeyPress) {
-			for (int i = 0; i < 256; ++i) {
-				if (GetAsyncKeyState(i) & 0x8000) {
-					keyCode = i;
-					keyName = GetKeyName(keyCode);
-					recordNextKeyPress = false;
-					break;
-				}
+			recordKeyPress(input::get_source()->snapshot());
+		}
+	}
+
+	// Records the lowest held key of a snapshot, shared by every bind recording in the same tick
+	void recordKeyPress(const input::key_state_t& state) {
+		if (recordNextKeyPress) {
+			const int key = state.first();
+			if (key > 0) {
+				keyCode = key;
+				recordNextKeyPress = false;
 			}
 		}
 	}
@@ -40,60 +66,33 @@ public:
 		return recordNextKeyPress;
 	}
 	void setToPressedKey() {
-		for (int i = 0; i < 256; ++i) {
-			if (GetAsyncKeyState(i) & 0x8000) {
-				keyCode = i;
-				keyName = GetKeyName(keyCode);
-				break;
-			}
+		const int key = input::get_source()->first_down();
+		if (key > 0) {
+			keyCode = key;
 		}
 	}
 
 	bool isDown() const {
-		return GetAsyncKeyState(keyCode) & 0x8000;
+		return input::get_source()->is_down(keyCode);
 	}
 
-	const std::string& toString() {
-		keyName = GetKeyName(keyCode);
-		return keyName;
+	// Name from the process wide table, resolved once per key code
+	const std::string& toString() const {
+		return input::get_key_name(keyCode);
 	}
 
 	void Set(int key) {
 		keyCode = key;
 	}
 
-	int Get() {
+	int Get() const {
 		return keyCode;
 	}
 
 
 private:
 	int keyCode;
-	std::string keyName;
 	bool recordNextKeyPress;
-	std::string GetKeyName(int vk_code) const {
-		switch (vk_code) {
-		case VK_MBUTTON: return "Middle Mouse Button";
-		case VK_LBUTTON: return "Left Mouse Button";
-		case VK_RBUTTON: return "Right Mouse Button";
-		case VK_CONTROL: return "Control Key";
-		case VK_MENU: return "Alt Key";
-		case VK_SHIFT: return "Shift Key";
-		case VK_CAPITAL: return "Caps Lock";
-		case VK_NUMLOCK: return "Num Lock";
-		case VK_SCROLL: return "Scroll Lock";
-		default: break;
-		}
-		UINT scancode = MapVirtualKey(vk_code, MAPVK_VK_TO_VSC);
-		char key_name[50];
-		int result = GetKeyNameTextA(scancode << 16, key_name, sizeof(key_name));
-		if (result > 0) {
-			return key_name;
-		}
-		else {
-			return "Unknown Key: " + std::to_string(vk_code);
-		}
-	}
 
 };
 
@@ -104,8 +103,17 @@ public:
 	}
 
 	void recordKeyPresses() {
+		bool recording = false;
+		for (AmiKeyBind* keyBind : keyBinds) {
+			recording |= keyBind->isRecording();
+		}
+		if (!recording) {
+			return;
+		}
+
+		const input::key_state_t state = input::get_source()->snapshot();
 		for (AmiKeyBind* keyBind : keyBinds) {
-			keyBind->recordKeyPress();
+			keyBind->recordKeyPress(state);
 		}
 	}
 
@@ -152,50 +160,73 @@ struct Command {
 
 class FkeyBinds {
 private:
-	std::map<std::string, std::string> keybinds;  // To store key-value pairs
-	int hotkey;  // To store the hotkey
-	std::map<std::string, bool> previousKeyStates; // Tracks the previous states of keys to detect press/release
+	struct BindTable; // binds compiled by loadKeyBinds, shared between copies
 
-	int getKeyCodeFromKeyName(const std::string& keyName) {
-		for (const auto& pair : gMenuKeyData.keyNames) {
-			if (pair.first == keyName) {
-				return pair.second;
-			}
-		}
-		return -1; 
-	}
+	// A key change seen by the dispatcher, applied by poll() on the thread that owns the items
+	struct PendingKey {
+		int keyCode;
+		Command::ActionType action;
+		std::chrono::steady_clock::time_point changeTime;
+	};
+
+	std::map<std::string, std::string> keybinds;  // To store key-value pairs
+	int hotkey = -1;  // To store the hotkey
+	std::shared_ptr<const BindTable> bindTable;
+	input::key_state_t previousDown; // bound keys held at the last check, to detect press/release
+	mutable std::mutex pendingMutex; // guards the members above against the dispatcher and pendingKeys
+	std::vector<PendingKey> pendingKeys; // queued by checkKeysOnce
+	std::vector<PendingKey> dispatchingKeys; // swapped with pendingKeys by poll, so both keep their capacity
+	std::vector<uint32_t> observedChanges; // reused by every poll
+	std::shared_ptr<input::source_t> runningSource; // the source run() waits on, guarded by pendingMutex
+	std::atomic<bool> stopping = false;
+
+	void compileBinds();
+	void checkKeysOnce(input::source_t& source);
+	template <typename Tick>
+	void runLoop(Tick&& tick);
+	bool executeKey(int keyCode, Command::ActionType actionType);
 public:
 	FkeyBinds();
 	FkeyBinds(const std::string& filepath);
+	// copies the binds, never the queue or the running state of run()
+	FkeyBinds(const FkeyBinds& other) {
+		*this = other;
+	}
+	FkeyBinds& operator=(const FkeyBinds& other) {
+		if (this == &other) {
+			return *this;
+		}
+		std::scoped_lock lock(pendingMutex, other.pendingMutex);
+		keybinds = other.keybinds;
+		hotkey = other.hotkey;
+		bindTable = other.bindTable;
+		previousDown = other.previousDown;
+		return *this;
+	}
 	bool loadKeyBinds(const std::string& filepath);
 	std::string getBind(const std::string& key);  // Returns the command for a specific key
 	int getHotkey() const;  // Returns the hotkey
 	std::string getActionForBind(const std::string& key, const std::string& actionType);  // Returns the command's action for a specific key based on action type
-	void executeBind(const std::string& key, Command::ActionType actionType); // execute commands
+	void executeBind(const std::string& key, Command::ActionType actionType); // execute commands, on the thread that owns the items
 
-	void continuousKeyCheck() {
-		while (true) {
-			if (hotkey != 1 && !GetAsyncKeyState(hotkey)) {
-				continue;
-			}
-			for (const auto& bindPair : keybinds) {
-				std::string keyName = bindPair.first;
-				int keyCode = getKeyCodeFromKeyName(keyName);
+	// Takes one key snapshot and queues OnRelease then OnPress for the bound keys that changed,
+	// callable from any thread. Nothing is applied until poll() runs.
+	void checkKeysOnce();
 
-				short keyState = GetAsyncKeyState(keyCode);
-				bool isKeyPressed = keyState & 0x8000;
+	// Applies the queued key changes, publishing and notifying once for all of them. Call it from
+	// the thread that loads and sets the items, like config::watch::poll().
+	// Returns the number of key changes applied
+	size_t poll();
 
-				if (isKeyPressed && (previousKeyStates.find(keyName) == previousKeyStates.end() || !previousKeyStates[keyName])) {
-					executeBind(keyName, Command::ActionType::OnPress);
-				}
-				else if (!isKeyPressed && previousKeyStates[keyName]) {
-					executeBind(keyName, Command::ActionType::OnRelease);
-				}
+	// Queues key changes until stop() is called, sleeping while no key changes. Meant for a
+	// background thread while the owner thread calls poll().
+	void run();
 
-				previousKeyStates[keyName] = isKeyPressed;
-			}
-			Sleep(10);
-		}
-	}
-};
+	// Makes a running run() or continuousKeyCheck() return, callable from any thread. Does nothing
+	// while neither runs, so a later run() is not affected.
+	void stop();
 
+	// Checks and applies binds on the calling thread until stop() is called, for programs
+	// whose main thread does nothing else
+	void continuousKeyCheck();
+};
@@ -0,0 +1,90 @@
+#include "log.h"
+
+namespace shared::log
+{
+	namespace
+	{
+		std::mutex sink_mutex;
+		std::shared_ptr<sink_t> current_sink;
+		level_t requested_level = level_t::info;
+
+		void update_min_level()
+		{
+			detail::min_level.store(current_sink ? requested_level : level_t::off, std::memory_order_relaxed);
+		}
+
+		constexpr std::string_view level_names[] = { "trace", "debug", "info", "warning", "error", "off" };
+	}
+
+	file_sink_t::file_sink_t(const std::filesystem::path& path, const size_t buffer_size)
+		: m_buffer_size(buffer_size)
+	{
+#ifdef _WIN32
+		_wfopen_s(&m_file, path.c_str(), L"ab");
+#else
+		m_file = fopen(path.c_str(), "ab");
+#endif
+		m_buffer.reserve(buffer_size);
+	}
+
+	file_sink_t::~file_sink_t()
+	{
+		flush();
+		if (m_file)
+			fclose(m_file);
+	}
+
+	void file_sink_t::write(const level_t level, const std::string_view line)
+	{
+		if (!m_file)
+			return;
+
+		m_buffer.push_back('[');
+		m_buffer.append(level_names[static_cast<size_t>(level)]);
+		m_buffer.append("] ");
+		m_buffer.append(line);
+		m_buffer.push_back('\n');
+		if (m_buffer.size() >= m_buffer_size)
+			flush();
+	}
+
+	void file_sink_t::flush()
+	{
+		if (!m_file || m_buffer.empty())
+			return;
+
+		fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+		fflush(m_file);
+		m_buffer.clear();
+	}
+
+	void set_level(const level_t level)
+	{
+		std::lock_guard lock(sink_mutex);
+		requested_level = level;
+		update_min_level();
+	}
+
+	void set_sink(std::shared_ptr<sink_t> sink)
+	{
+		std::lock_guard lock(sink_mutex);
+		if (current_sink)
+			current_sink->flush();
+		current_sink = std::move(sink);
+		update_min_level();
+	}
+
+	void write(const level_t level, const std::string_view line)
+	{
+		std::lock_guard lock(sink_mutex);
+		if (current_sink)
+			current_sink->write(level, line);
+	}
+
+	void flush()
+	{
+		std::lock_guard lock(sink_mutex);
+		if (current_sink)
+			current_sink->flush();
+	}
+}
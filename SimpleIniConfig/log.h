@@ -0,0 +1,132 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include "numconv.h"
+
+#ifndef CONFIG_LOG_MIN_LEVEL
+// Messages below this level are compiled out, their arguments are never evaluated. 0 keeps every
+// level, 5 (off) removes logging entirely.
+#define CONFIG_LOG_MIN_LEVEL 0
+#endif
+
+// Logs a message built from the arguments, e.g. CONFIG_LOG(warning, "Invalid value for key ", key)
+#define CONFIG_LOG(lvl, ...) \
+	do { \
+		if constexpr (shared::log::compiled_in(shared::log::level_t::lvl)) \
+			if (shared::log::enabled(shared::log::level_t::lvl)) \
+				shared::log::print(shared::log::level_t::lvl, __VA_ARGS__); \
+	} while (0)
+
+namespace shared::log
+{
+	enum class level_t : uint8_t
+	{
+		trace, // every key that is read or written
+		debug,
+		info,
+		warning, // bad values and unknown keys
+		error, // files that could not be read or written
+		off,
+	};
+
+	/// <summary>
+	/// Receives finished log lines, write may be called from any thread but never concurrently
+	/// </summary>
+	class sink_t
+	{
+	public:
+		virtual ~sink_t() = default;
+		virtual void write(const level_t level, const std::string_view line) = 0;
+		virtual void flush() {}
+	};
+
+	/// <summary>
+	/// Appends to a file through a buffer, nothing is flushed per line. The buffer is written
+	/// when it fills up, on flush() and when the sink is destroyed.
+	/// </summary>
+	class file_sink_t : public sink_t
+	{
+	public:
+		file_sink_t(const std::filesystem::path& path, const size_t buffer_size = 64 * 1024);
+		~file_sink_t() override;
+
+		void write(const level_t level, const std::string_view line) override;
+		void flush() override;
+
+	private:
+		FILE* m_file = nullptr;
+		std::string m_buffer;
+		size_t m_buffer_size;
+	};
+
+	namespace detail
+	{
+		inline std::atomic<level_t> min_level = level_t::off; // off while there is no sink
+
+		inline void append(std::string& out, const std::string_view text) { out.append(text); }
+		inline void append(std::string& out, const char* text) { out.append(text); }
+		inline void append(std::string& out, const std::string& text) { out.append(text); }
+		inline void append(std::string& out, const char chr) { out.push_back(chr); }
+		inline void append(std::string& out, const bool val) { out.append(val ? "true" : "false"); }
+		inline void append(std::string& out, const std::filesystem::path& path) { out.append(path.string()); }
+
+		template< typename t > requires std::is_arithmetic_v<t>
+		void append(std::string& out, const t val)
+		{
+			num::append(out, val);
+		}
+	}
+
+	/// <summary>
+	/// Sets the lowest level that is passed to the sink, default info
+	/// </summary>
+	/// <param name="level">Lowest level, off disables logging</param>
+	void set_level(const level_t level);
+
+	/// <summary>
+	/// Replaces the sink, there is none by default so nothing is logged until one is set
+	/// </summary>
+	/// <param name="sink">New sink or nullptr</param>
+	void set_sink(std::shared_ptr<sink_t> sink);
+
+	/// <summary>
+	/// Is the level at or above CONFIG_LOG_MIN_LEVEL, CONFIG_LOG drops messages below it at compile time
+	/// </summary>
+	constexpr bool compiled_in(const level_t level)
+	{
+		return level >= static_cast<level_t>(CONFIG_LOG_MIN_LEVEL);
+	}
+
+	/// <summary>
+	/// Would a message of this level reach a sink, a single relaxed load
+	/// </summary>
+	inline bool enabled(const level_t level)
+	{
+		return level >= detail::min_level.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Passes a finished line to the sink
+	/// </summary>
+	void write(const level_t level, const std::string_view line);
+
+	/// <summary>
+	/// Flushes the sink
+	/// </summary>
+	void flush();
+
+	template< typename... args_t >
+	void print(const level_t level, const args_t&... args)
+	{
+		std::string line;
+		(detail::append(line, args), ...);
+		write(level, line);
+	}
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <cstdint>
+#include "color.h"
+
+// Locale independent, non-throwing number conversions on top of std::from_chars/std::to_chars.
+// Parsing works on views, formatting appends straight into the output buffer.
+namespace shared::num
+{
+	/// <summary>
+	/// Parses the whole of text as a number, an optional leading '+' is accepted
+	/// </summary>
+	/// <param name="text">Text to parse, must not contain surrounding whitespace</param>
+	/// <param name="out">Parsed value, left untouched on failure</param>
+	/// <returns>Was text a valid number</returns>
+	template< typename t >
+	bool parse(std::string_view text, t& out)
+	{
+		if (!text.empty() && text.front() == '+')
+		{
+			text.remove_prefix(1);
+			if (!text.empty() && (text.front() == '-' || text.front() == '+'))
+				return false; // from_chars would take the second sign
+		}
+
+		t val{};
+		const auto result = std::from_chars(text.data(), text.data() + text.size(), val);
+		if (result.ec != std::errc() || result.ptr != text.data() + text.size())
+			return false;
+
+		out = val;
+		return true;
+	}
+
+	/// <summary>
+	/// Appends the shortest text that parses back to the same value
+	/// </summary>
+	/// <param name="out">Buffer to append to</param>
+	/// <param name="val">Value to format</param>
+	template< typename t >
+	void append(std::string& out, const t val)
+	{
+		char buffer[32];
+		const auto result = std::to_chars(buffer, buffer + sizeof(buffer), val);
+		out.append(buffer, result.ptr);
+	}
+
+	template< typename t >
+	std::string to_string(const t val)
+	{
+		std::string out;
+		append(out, val);
+		return out;
+	}
+
+	/// <summary>
+	/// Parses a comma separated list of numbers in one pass without splitting it, calling fn(value)
+	/// for every element. Whitespace around elements and a trailing comma are accepted.
+	/// </summary>
+	/// <param name="text">Text to parse</param>
+	/// <param name="fn">Receives each element, returning false stops parsing with an error</param>
+	/// <returns>Was every element a valid number</returns>
+	template< typename t, typename fn_t >
+	bool parse_list(std::string_view text, fn_t&& fn)
+	{
+		const char* cur = text.data();
+		const char* const end = cur + text.size();
+		const auto skip_space = [&cur, end]() {
+			while (cur != end && (*cur == ' ' || *cur == '\t'))
+				++cur;
+		};
+
+		skip_space();
+		while (cur != end)
+		{
+			if (*cur == '+')
+			{
+				++cur;
+				if (cur != end && (*cur == '-' || *cur == '+'))
+					return false;
+			}
+
+			t val{};
+			const auto result = std::from_chars(cur, end, val);
+			if (result.ec != std::errc() || !fn(val))
+				return false;
+
+			cur = result.ptr;
+			skip_space();
+			if (cur == end)
+				break;
+			if (*cur != ',')
+				return false;
+			++cur;
+			skip_space();
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Parses a color written as "r,g,b,a" or as hex "#RRGGBB" / "#RRGGBBAA"
+	/// </summary>
+	/// <param name="text">Text to parse</param>
+	/// <param name="out">Parsed color, left untouched on failure</param>
+	/// <returns>Was text a valid color</returns>
+	inline bool parse_color(std::string_view text, shared::col_t& out)
+	{
+		if (!text.empty() && text.front() == '#')
+		{
+			text.remove_prefix(1);
+			if (text.size() != 6 && text.size() != 8)
+				return false;
+
+			uint32_t packed = 0;
+			const auto result = std::from_chars(text.data(), text.data() + text.size(), packed, 16);
+			if (result.ec != std::errc() || result.ptr != text.data() + text.size())
+				return false;
+			if (text.size() == 6)
+				packed = (packed << 8) | 0xFF;
+
+			out.set(int(packed >> 24), int((packed >> 16) & 0xFF), int((packed >> 8) & 0xFF), int(packed & 0xFF));
+			return true;
+		}
+
+		int components[4];
+		size_t count = 0;
+		const bool parsed = parse_list<int>(text, [&](const int val) {
+			if (count == 4)
+				return false;
+			components[count++] = val;
+			return true;
+		});
+		if (!parsed || count != 4)
+			return false;
+
+		out.set(components[0], components[1], components[2], components[3]);
+		return true;
+	}
+
+	/// <summary>
+	/// Appends a color as "r,g,b,a"
+	/// </summary>
+	inline void append_color(std::string& out, const shared::col_t& col)
+	{
+		append(out, col.r());
+		out += ',';
+		append(out, col.g());
+		out += ',';
+		append(out, col.b());
+		out += ',';
+		append(out, col.a());
+	}
+
+	/// <summary>
+	/// Appends a color as "#RRGGBBAA"
+	/// </summary>
+	inline void append_color_hex(std::string& out, const shared::col_t& col)
+	{
+		constexpr char digits[] = "0123456789ABCDEF";
+		out += '#';
+		for (const uint8_t component : col.m_color)
+		{
+			out += digits[component >> 4];
+			out += digits[component & 0xF];
+		}
+	}
+}
@@ -0,0 +1,101 @@
+#include "observer.h"
+
+namespace config
+{
+	namespace
+	{
+		struct subscription_t
+		{
+			uint32_t id;
+			int64_t item; // -1 for section subscriptions
+			std::string section;
+			std::shared_ptr<observer_t> observer; // shared so a dispatch in progress survives unsubscribe
+		};
+
+		std::vector<subscription_t> subscriptions;
+		uint32_t next_id = 1;
+
+		bool section_equals(const std::string_view lhs, const std::string_view rhs)
+		{
+			return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+				[](char c1, char c2) {
+					return shared::hash::fold(c1) == shared::hash::fold(c2);
+				});
+		}
+
+		bool covers(const subscription_t& subscription, const uint32_t index)
+		{
+			if (subscription.item >= 0)
+				return subscription.item == index;
+			return section_equals(subscription.section, get_items()[index].m_section);
+		}
+
+		void update_observed()
+		{
+			auto& items = get_items();
+			for (uint32_t i = 0; i < items.size(); ++i)
+			{
+				items[i].m_observed = std::any_of(subscriptions.begin(), subscriptions.end(),
+					[i](const subscription_t& subscription) { return covers(subscription, i); });
+			}
+		}
+
+		uint32_t add_subscription(subscription_t&& subscription)
+		{
+			subscription.id = next_id++;
+			subscriptions.push_back(std::move(subscription));
+			update_observed();
+			return subscriptions.back().id;
+		}
+	}
+
+	uint32_t subscribe(const uint32_t index, observer_t observer)
+	{
+		get_items().at(index); // throws like get_item for unknown indices
+		return add_subscription(subscription_t{ 0, index, {}, std::make_shared<observer_t>(std::move(observer)) });
+	}
+
+	uint32_t subscribe_section(const std::string_view section, observer_t observer)
+	{
+		return add_subscription(subscription_t{ 0, -1, std::string(section), std::make_shared<observer_t>(std::move(observer)) });
+	}
+
+	void unsubscribe(const uint32_t id)
+	{
+		std::erase_if(subscriptions, [id](const subscription_t& subscription) { return subscription.id == id; });
+		update_observed();
+	}
+
+	void notify(std::span<const uint32_t> changed)
+	{
+		if (subscriptions.empty() || changed.empty())
+			return;
+
+		// observers may subscribe or unsubscribe, so dispatch from a copy
+		const auto current = subscriptions;
+		std::vector<uint32_t> batch;
+		batch.reserve(changed.size());
+		for (const auto& subscription : current)
+		{
+			const uint32_t id = subscription.id;
+			if (std::none_of(subscriptions.begin(), subscriptions.end(), [id](const subscription_t& active) { return active.id == id; }))
+				continue; // unsubscribed by an earlier observer of this batch
+
+			batch.clear();
+			for (const uint32_t index : changed)
+			{
+				if (get_items()[index].m_observed && covers(subscription, index))
+					batch.push_back(index);
+			}
+
+			if (!batch.empty())
+				(*subscription.observer)(batch);
+		}
+	}
+
+	bool is_section_observed(const std::string_view section)
+	{
+		return std::any_of(subscriptions.begin(), subscriptions.end(),
+			[section](const subscription_t& subscription) { return subscription.item < 0 && section_equals(subscription.section, section); });
+	}
+}
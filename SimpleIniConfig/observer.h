@@ -0,0 +1,52 @@
+#pragma once
+#include "config.h"
+#include <span>
+
+// Subscriptions are not locked, subscribe, unsubscribe and notify belong to the thread that loads
+// and sets the items. Every notify of this library runs there: load_settings, reload_settings
+// through config::watch::poll and keybinds through FkeyBinds::poll, never the keybind dispatcher.
+namespace config
+{
+	/// <summary>
+	/// Called once per load, reload or keybind poll with the indices of the changed items
+	/// the subscription covers
+	/// </summary>
+	using observer_t = std::function<void(std::span<const uint32_t> changed)>;
+
+	/// <summary>
+	/// Subscribes to changes of one item. Only observed items are compared on load, changes of
+	/// items nobody subscribed to cost nothing.
+	/// </summary>
+	/// <param name="index">Index of the config item</param>
+	/// <param name="observer">Callback, runs on the thread that loads and sets the items</param>
+	/// <returns>Id for unsubscribe</returns>
+	uint32_t subscribe(const uint32_t index, observer_t observer);
+
+	/// <summary>
+	/// Subscribes to changes of every item in a section, compared case-insensitively. Items
+	/// registered into the section later are covered as well.
+	/// </summary>
+	/// <param name="section">Name of the section</param>
+	/// <param name="observer">Callback, runs on the thread that loads and sets the items</param>
+	/// <returns>Id for unsubscribe</returns>
+	uint32_t subscribe_section(const std::string_view section, observer_t observer);
+
+	/// <summary>
+	/// Removes a subscription, it is safe to call from inside an observer
+	/// </summary>
+	/// <param name="id">Id returned by subscribe</param>
+	void unsubscribe(const uint32_t id);
+
+	/// <summary>
+	/// Delivers one batch of changes to the subscribers, for code that changes items through set().
+	/// Items nobody observes are skipped.
+	/// </summary>
+	/// <param name="changed">Indices of the changed items</param>
+	void notify(std::span<const uint32_t> changed);
+
+	/// <summary>
+	/// Does a section subscription cover the section, used when registering items
+	/// </summary>
+	/// <param name="section">Name of the section</param>
+	bool is_section_observed(const std::string_view section);
+}
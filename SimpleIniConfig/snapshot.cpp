@@ -0,0 +1,159 @@
+#include "snapshot.h"
+#include <limits>
+#include <memory>
+#include <mutex>
+
+namespace config
+{
+	namespace
+	{
+		// Epoch a reader entered with, 0 while the thread holds no guard. One slot per thread,
+		// slots are reused by later threads and never freed so publish can walk them at any time.
+		struct alignas(64) reader_slot_t
+		{
+			std::atomic<uint64_t> epoch{ 0 };
+			std::atomic<bool> in_use{ true };
+			reader_slot_t* next = nullptr;
+		};
+
+		std::atomic<reader_slot_t*> reader_slots{ nullptr };
+		std::atomic<snapshot_t*> current_snapshot{ nullptr };
+		std::atomic<uint64_t> global_epoch{ 1 };
+
+		reader_slot_t* acquire_slot()
+		{
+			for (auto* slot = reader_slots.load(); slot; slot = slot->next)
+			{
+				bool expected = false;
+				if (!slot->in_use.load(std::memory_order_relaxed) && slot->in_use.compare_exchange_strong(expected, true))
+					return slot;
+			}
+
+			auto* slot = new reader_slot_t;
+			slot->next = reader_slots.load();
+			while (!reader_slots.compare_exchange_weak(slot->next, slot))
+				;
+			return slot;
+		}
+
+		// Only touched by its own thread, the slot is claimed on the first guard of the thread
+		struct reader_t
+		{
+			reader_slot_t* slot = nullptr;
+			uint32_t depth = 0;
+			const snapshot_t* pinned = nullptr;
+
+			~reader_t()
+			{
+				if (slot)
+					slot->in_use.store(false, std::memory_order_release);
+			}
+		};
+		thread_local reader_t reader;
+
+		struct writer_t
+		{
+			std::mutex mutex;
+			uint64_t version = 0;
+			// snapshots replaced by a publish, with the epoch every reader must have reached before they are reused
+			std::vector<std::pair<uint64_t, std::unique_ptr<snapshot_t>>> retired;
+			// snapshots no reader holds anymore, publish assigns into them so their buffers are reused
+			std::vector<std::unique_ptr<snapshot_t>> spare;
+
+			~writer_t()
+			{
+				delete current_snapshot.load();
+			}
+
+			void reclaim()
+			{
+				uint64_t oldest = std::numeric_limits<uint64_t>::max();
+				for (auto* slot = reader_slots.load(); slot; slot = slot->next)
+				{
+					const uint64_t epoch = slot->epoch.load();
+					if (epoch != 0 && epoch < oldest)
+						oldest = epoch;
+				}
+
+				std::erase_if(retired, [this, oldest](auto& entry) {
+					if (entry.first > oldest)
+						return false;
+					if (spare.size() < MAX_SPARE)
+						spare.push_back(std::move(entry.second));
+					return true;
+				});
+			}
+
+			static constexpr size_t MAX_SPARE = 2;
+		};
+
+		writer_t& get_writer()
+		{
+			static writer_t writer;
+			return writer;
+		}
+	}
+
+	uint64_t publish()
+	{
+		auto& writer = get_writer();
+		std::lock_guard lock(writer.mutex);
+
+		std::unique_ptr<snapshot_t> next;
+		if (writer.spare.empty())
+			next = std::make_unique<snapshot_t>();
+		else
+		{
+			next = std::move(writer.spare.back());
+			writer.spare.pop_back();
+		}
+
+		next->version = ++writer.version;
+		const auto& items = get_items();
+		next->values.resize(items.size());
+		for (size_t i = 0; i < items.size(); ++i)
+		{
+			// built-in values of a reused snapshot are assigned into their old storage, std::any values
+			// as well when their codec can assign in place
+			auto& value = next->values[i];
+			const auto* held = std::get_if<std::any>(&value);
+			if (held && held->has_value() && std::holds_alternative<std::any>(items[i].m_var) && held->type() == std::get<std::any>(items[i].m_var).type())
+			{
+				const auto* codec = find_codec(items[i].m_type);
+				if (codec && codec->assign)
+				{
+					codec->assign(items[i].m_var, value);
+					continue;
+				}
+			}
+			value = items[i].m_var;
+		}
+
+		snapshot_t* previous = current_snapshot.exchange(next.release());
+		// readers that enter from this epoch on can only load the new snapshot
+		const uint64_t safe_epoch = global_epoch.fetch_add(1) + 1;
+		if (previous)
+			writer.retired.emplace_back(safe_epoch, previous);
+		writer.reclaim();
+		return writer.version;
+	}
+
+	read_guard::read_guard()
+	{
+		if (reader.depth++ == 0)
+		{
+			if (!reader.slot)
+				reader.slot = acquire_slot();
+			// the epoch has to be visible before the snapshot is loaded, a seq_cst store orders the two
+			reader.slot->epoch.store(global_epoch.load());
+			reader.pinned = current_snapshot.load();
+		}
+		m_snapshot = reader.pinned;
+	}
+
+	read_guard::~read_guard()
+	{
+		if (--reader.depth == 0)
+			reader.slot->epoch.store(0, std::memory_order_release);
+	}
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "config.h"
+#include <atomic>
+
+namespace config
+{
+	/// <summary>
+	/// Immutable copy of every item value. Readers on other threads see the items only through
+	/// published snapshots, the items themselves belong to the thread that loads and sets them.
+	/// </summary>
+	struct snapshot_t
+	{
+		uint64_t version;
+		std::vector<value_t> values; // by item index
+	};
+
+	/// <summary>
+	/// Copies the current item values into a new snapshot and makes it the one new readers see.
+	/// load_settings and FkeyBinds::poll publish on their own, call this after changing items
+	/// through set(). The previous snapshot is freed once no reader holds it anymore.
+	/// </summary>
+	/// <returns>Version of the published snapshot</returns>
+	uint64_t publish();
+
+	/// <summary>
+	/// Pins the current snapshot for reading from any thread. Entering and leaving are plain loads
+	/// and stores into a slot owned by the thread, the read path takes no lock and does no atomic
+	/// read-modify-write. Keep guards short lived, publish holds old snapshots until they are gone.
+	/// Guards may nest on one thread and always see the snapshot the outermost guard pinned.
+	/// </summary>
+	class read_guard
+	{
+	public:
+		read_guard();
+		~read_guard();
+		read_guard(const read_guard&) = delete;
+		read_guard& operator=(const read_guard&) = delete;
+
+		/// <summary>
+		/// Gets the value of an item at the time of the snapshot
+		/// </summary>
+		/// <param name="index">Index of the config item</param>
+		/// <returns>Item value, nullptr if the item was registered after the snapshot or holds another type</returns>
+		template< typename t >
+		const t* find(const uint32_t index) const
+		{
+			if (!m_snapshot || index >= m_snapshot->values.size())
+				return nullptr;
+
+			return value_ptr<t>(m_snapshot->values[index]);
+		}
+
+		/// <summary>
+		/// Gets the value of an item at the time of the snapshot
+		/// </summary>
+		/// <param name="index">Index of the config item</param>
+		/// <returns>Item value, throws std::out_of_range when find would return nullptr</returns>
+		template< typename t >
+		const t& get(const uint32_t index) const
+		{
+			const t* val = find<t>(index);
+			if (!val)
+				throw std::out_of_range("config item is not in the snapshot");
+			return *val;
+		}
+
+		template< typename t >
+		const t& get(const cfg_handle<t>& handle) const
+		{
+			return get<t>(handle.index());
+		}
+
+		/// <summary>
+		/// Version of the pinned snapshot, 0 before the first publish
+		/// </summary>
+		uint64_t version() const
+		{
+			return m_snapshot ? m_snapshot->version : 0;
+		}
+
+	private:
+		const snapshot_t* m_snapshot;
+	};
+}
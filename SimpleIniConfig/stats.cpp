@@ -0,0 +1,98 @@
+#include "stats.h"
+#include "numconv.h"
+#include <algorithm>
+#include <cmath>
+
+namespace config::stats
+{
+	namespace
+	{
+		constexpr const char* counter_names[COUNTER_COUNT] = { "bytes_read", "bytes_written", "items_parsed", "unknown_keys", "parse_errors", "lookups", "cache_hits" };
+		constexpr const char* phase_names[PHASE_COUNT] = { "read", "tokenize", "lookup", "convert", "apply", "write", "dispatch" };
+
+		void append_us(std::string& out, const char* name, const uint64_t ns)
+		{
+			out.push_back(' ');
+			out.append(name);
+			out.push_back(' ');
+			shared::num::append(out, static_cast<double>(ns) / 1000.0);
+		}
+	}
+
+	uint64_t histogram_t::percentile_ns(const double fraction) const
+	{
+		if (count == 0)
+			return 0;
+
+		const auto target = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count))), 1);
+		uint64_t seen = 0;
+		for (size_t i = 0; i < BUCKET_COUNT; ++i)
+		{
+			seen += buckets[i];
+			if (seen >= target)
+				return std::min(max_ns, (uint64_t(1) << i) - 1);
+		}
+		return max_ns;
+	}
+
+	snapshot_t get()
+	{
+		snapshot_t snapshot;
+		for (size_t i = 0; i < COUNTER_COUNT; ++i)
+			snapshot.counters[i] = detail::counters[i].load(std::memory_order_relaxed);
+
+		for (size_t i = 0; i < PHASE_COUNT; ++i)
+		{
+			const auto& from = detail::phases[i];
+			auto& to = snapshot.phases[i];
+			to.count = from.count.load(std::memory_order_relaxed);
+			to.total_ns = from.total_ns.load(std::memory_order_relaxed);
+			to.max_ns = from.max_ns.load(std::memory_order_relaxed);
+			for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket)
+				to.buckets[bucket] = from.buckets[bucket].load(std::memory_order_relaxed);
+		}
+		return snapshot;
+	}
+
+	void reset()
+	{
+		for (auto& counter : detail::counters)
+			counter.store(0, std::memory_order_relaxed);
+
+		for (auto& phase : detail::phases)
+		{
+			phase.count.store(0, std::memory_order_relaxed);
+			phase.total_ns.store(0, std::memory_order_relaxed);
+			phase.max_ns.store(0, std::memory_order_relaxed);
+			for (auto& bucket : phase.buckets)
+				bucket.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	std::string dump(const snapshot_t& snapshot)
+	{
+		std::string out;
+		for (size_t i = 0; i < COUNTER_COUNT; ++i)
+		{
+			out.append(counter_names[i]);
+			out.push_back(' ');
+			shared::num::append(out, snapshot.counters[i]);
+			out.push_back('\n');
+		}
+
+		for (size_t i = 0; i < PHASE_COUNT; ++i)
+		{
+			const auto& phase = snapshot.phases[i];
+			out.append("phase_");
+			out.append(phase_names[i]);
+			out.append(" count ");
+			shared::num::append(out, phase.count);
+			append_us(out, "total_us", phase.total_ns);
+			append_us(out, "max_us", phase.max_ns);
+			append_us(out, "p50_us", phase.percentile_ns(0.5));
+			append_us(out, "p99_us", phase.percentile_ns(0.99));
+			out.push_back('\n');
+		}
+		return out;
+	}
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#ifndef CONFIG_STATS
+// 0 compiles every counter and timer out
+#define CONFIG_STATS 1
+#endif
+
+// Relaxed counters and log2 latency histograms of load, save, parse and keybind execution.
+// Updating is a relaxed atomic add, timing a phase costs two steady_clock reads.
+namespace config::stats
+{
+	enum counter_t : uint8_t
+	{
+		BYTES_READ,
+		BYTES_WRITTEN,
+		ITEMS_PARSED, // values that were converted and assigned
+		UNKNOWN_KEYS, // keys in a file that match no item
+		PARSE_ERRORS, // values a codec rejected
+		LOOKUPS, // does_item_exist calls
+		CACHE_HITS, // loads answered by the binary snapshot
+		COUNTER_COUNT,
+	};
+
+	enum phase_t : uint8_t
+	{
+		PHASE_READ, // opening and mapping files
+		PHASE_TOKENIZE, // splitting text into sections, keys and values
+		PHASE_LOOKUP, // finding the items of keys
+		PHASE_CONVERT, // text to value and value to text
+		PHASE_APPLY, // publishing snapshots and notifying observers
+		PHASE_WRITE, // writing and syncing files
+		PHASE_DISPATCH, // from a key change to its bind commands being applied
+		PHASE_COUNT,
+	};
+
+	constexpr size_t BUCKET_COUNT = 40; // bucket i counts durations below 2^i ns, the last one everything longer
+
+	struct histogram_t
+	{
+		uint64_t count = 0;
+		uint64_t total_ns = 0;
+		uint64_t max_ns = 0;
+		std::array<uint64_t, BUCKET_COUNT> buckets{};
+
+		/// <summary>
+		/// Upper bound of the bucket holding the given fraction of samples, 0.99 for p99
+		/// </summary>
+		uint64_t percentile_ns(const double fraction) const;
+	};
+
+	struct snapshot_t
+	{
+		std::array<uint64_t, COUNTER_COUNT> counters{};
+		std::array<histogram_t, PHASE_COUNT> phases{};
+	};
+
+	namespace detail
+	{
+		struct histogram_t
+		{
+			std::atomic<uint64_t> count{ 0 };
+			std::atomic<uint64_t> total_ns{ 0 };
+			std::atomic<uint64_t> max_ns{ 0 };
+			std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets{};
+		};
+
+		inline std::array<std::atomic<uint64_t>, COUNTER_COUNT> counters{};
+		inline std::array<histogram_t, PHASE_COUNT> phases{};
+	}
+
+	inline void add(const counter_t counter, const uint64_t amount = 1)
+	{
+#if CONFIG_STATS
+		detail::counters[counter].fetch_add(amount, std::memory_order_relaxed);
+#else
+		(void)counter, (void)amount;
+#endif
+	}
+
+	inline void record(const phase_t phase, const std::chrono::nanoseconds duration)
+	{
+#if CONFIG_STATS
+		const uint64_t ns = static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0));
+		auto& histogram = detail::phases[phase];
+		histogram.count.fetch_add(1, std::memory_order_relaxed);
+		histogram.total_ns.fetch_add(ns, std::memory_order_relaxed);
+		histogram.buckets[std::min<size_t>(std::bit_width(ns), BUCKET_COUNT - 1)].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t max = histogram.max_ns.load(std::memory_order_relaxed);
+		while (ns > max && !histogram.max_ns.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+			;
+#else
+		(void)phase, (void)duration;
+#endif
+	}
+
+	/// <summary>
+	/// Times phases from construction to destruction. switch_to moves the clock to another phase
+	/// with a single clock read, so interleaved phases of one operation add up to one sample each.
+	/// </summary>
+	class timer_t
+	{
+	public:
+		explicit timer_t(const phase_t phase)
+		{
+#if CONFIG_STATS
+			m_phase = phase;
+			m_start = std::chrono::steady_clock::now();
+#else
+			(void)phase;
+#endif
+		}
+
+		~timer_t()
+		{
+#if CONFIG_STATS
+			stop();
+			for (size_t i = 0; i < PHASE_COUNT; ++i)
+			{
+				if (m_used & (1u << i))
+					record(static_cast<phase_t>(i), m_elapsed[i]);
+			}
+#endif
+		}
+
+		void switch_to(const phase_t phase)
+		{
+#if CONFIG_STATS
+			const auto now = std::chrono::steady_clock::now();
+			if (m_phase != PHASE_COUNT)
+			{
+				m_elapsed[m_phase] += now - m_start;
+				m_used |= 1u << m_phase;
+			}
+			m_phase = phase;
+			m_start = now;
+#else
+			(void)phase;
+#endif
+		}
+
+		/// <summary>
+		/// Stops the clock until the next switch_to
+		/// </summary>
+		void stop()
+		{
+			switch_to(PHASE_COUNT);
+		}
+
+	private:
+#if CONFIG_STATS
+		phase_t m_phase;
+		uint32_t m_used = 0;
+		std::chrono::steady_clock::time_point m_start;
+		std::array<std::chrono::nanoseconds, PHASE_COUNT> m_elapsed{};
+#endif
+	};
+
+	/// <summary>
+	/// Copies the current counters and histograms
+	/// </summary>
+	snapshot_t get();
+
+	/// <summary>
+	/// Sets every counter and histogram back to zero
+	/// </summary>
+	void reset();
+
+	/// <summary>
+	/// Formats a snapshot as "name value" lines, histograms as count, total, max, p50 and p99 in microseconds
+	/// </summary>
+	std::string dump(const snapshot_t& snapshot);
+
+	inline std::string dump()
+	{
+		return dump(get());
+	}
+}
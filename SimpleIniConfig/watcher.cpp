@@ -0,0 +1,197 @@
+#include "watcher.h"
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace config::watch
+{
+	namespace
+	{
+		/// <summary>
+		/// Collects the paths of changed files in one directory, it never touches the items
+		/// </summary>
+		class watcher_t
+		{
+		public:
+			watcher_t(const std::filesystem::path& directory, const std::chrono::milliseconds interval)
+				: m_directory(directory), m_interval(interval)
+			{
+				scan(false);
+				m_thread = std::thread(&watcher_t::run, this);
+			}
+
+			~watcher_t()
+			{
+				m_stopping = true;
+				m_thread.join();
+			}
+
+			std::set<std::string> take_changed()
+			{
+				std::lock_guard lock(m_mutex);
+				return std::exchange(m_changed, {});
+			}
+
+		private:
+			void run()
+			{
+#ifdef _WIN32
+				HANDLE notification = FindFirstChangeNotificationA(m_directory.string().c_str(), FALSE, FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+				if (notification == INVALID_HANDLE_VALUE)
+					return run_polling();
+
+				// the notification does not tell which file changed, the file times do
+				while (!m_stopping)
+				{
+					if (WaitForSingleObject(notification, 100) != WAIT_OBJECT_0)
+						continue;
+
+					scan(true);
+					if (!FindNextChangeNotification(notification))
+						break;
+				}
+				FindCloseChangeNotification(notification);
+				if (!m_stopping)
+					run_polling();
+#else
+				const int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+				if (fd < 0 || inotify_add_watch(fd, m_directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+				{
+					if (fd >= 0)
+						close(fd);
+					return run_polling();
+				}
+
+				alignas(inotify_event) char buffer[4096];
+				while (!m_stopping)
+				{
+					pollfd pfd{ fd, POLLIN, 0 };
+					if (::poll(&pfd, 1, 100) <= 0)
+						continue;
+
+					ssize_t len;
+					while ((len = read(fd, buffer, sizeof(buffer))) > 0)
+					{
+						std::lock_guard lock(m_mutex);
+						for (ssize_t offset = 0; offset < len;)
+						{
+							const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+							if (event->len)
+								m_changed.insert((m_directory / event->name).string());
+							offset += sizeof(inotify_event) + event->len;
+						}
+					}
+				}
+				close(fd);
+#endif
+			}
+
+			void run_polling()
+			{
+				while (!m_stopping)
+				{
+					std::this_thread::sleep_for(m_interval);
+					scan(true);
+				}
+			}
+
+			void scan(const bool report)
+			{
+				std::error_code err;
+				for (const auto& entry : std::filesystem::directory_iterator(m_directory, err))
+				{
+					if (!entry.is_regular_file(err))
+						continue;
+
+					const auto write_time = entry.last_write_time(err);
+					auto [it, inserted] = m_write_times.try_emplace(entry.path().string(), write_time);
+					if (!inserted && it->second == write_time)
+						continue;
+
+					it->second = write_time;
+					if (report)
+					{
+						std::lock_guard lock(m_mutex);
+						m_changed.insert(it->first);
+					}
+				}
+			}
+
+			std::filesystem::path m_directory;
+			std::chrono::milliseconds m_interval;
+			std::unordered_map<std::string, std::filesystem::file_time_type> m_write_times; // only used by scan
+			std::mutex m_mutex;
+			std::set<std::string> m_changed;
+			std::atomic<bool> m_stopping = false;
+			std::thread m_thread;
+		};
+
+		std::unique_ptr<watcher_t> watcher;
+		std::function<void(uint32_t)> change_callback;
+		stats_t stats;
+	}
+
+	bool start(std::function<void(uint32_t)> on_change, const std::chrono::milliseconds interval)
+	{
+		stop();
+
+		std::error_code err;
+		const std::filesystem::path directory = get_config_directory();
+		std::filesystem::create_directories(directory, err);
+		if (!std::filesystem::is_directory(directory, err))
+			return false;
+
+		change_callback = std::move(on_change);
+		watcher = std::make_unique<watcher_t>(directory, interval);
+		return true;
+	}
+
+	void stop()
+	{
+		watcher.reset();
+		change_callback = nullptr;
+	}
+
+	size_t poll()
+	{
+		if (!watcher)
+			return 0;
+
+		const auto changed = watcher->take_changed();
+		if (changed.empty())
+			return 0;
+
+		flush(); // so our own async saves count as loaded
+		const auto loaded = get_loaded_config();
+		if (loaded.path.empty() || !changed.contains(loaded.path))
+			return 0;
+
+		std::error_code err;
+		const auto write_time = std::filesystem::last_write_time(loaded.path, err);
+		if (err || write_time == loaded.write_time)
+			return 0; // written by save or already loaded
+
+		const size_t changed_items = reload_file(loaded.path, change_callback);
+		if (changed_items == 0)
+			return 0;
+
+		const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::filesystem::file_time_type::clock::now() - write_time);
+		stats.reloads++;
+		stats.changed_items += changed_items;
+		stats.last_latency = latency;
+		stats.max_latency = std::max(stats.max_latency, latency);
+		return changed_items;
+	}
+
+	stats_t get_stats()
+	{
+		return stats;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "config.h"
+
+namespace config::watch
+{
+	struct stats_t
+	{
+		uint64_t reloads = 0; // reloads that changed at least one item
+		uint64_t changed_items = 0;
+		std::chrono::microseconds last_latency{ 0 }; // from the file write to the changes being applied
+		std::chrono::microseconds max_latency{ 0 };
+	};
+
+	/// <summary>
+	/// Starts watching the config directory for edited files on a background thread, using
+	/// inotify on Linux, change notifications on Windows and polling the file times otherwise.
+	/// Nothing is applied on that thread, call poll() from the thread that owns the items.
+	/// </summary>
+	/// <param name="on_change">Called by poll() with the index of every item a reload changed</param>
+	/// <param name="interval">Polling interval when no change notification is available</param>
+	/// <returns>Is the watcher running</returns>
+	bool start(std::function<void(uint32_t)> on_change = {}, const std::chrono::milliseconds interval = std::chrono::milliseconds(250));
+
+	/// <summary>
+	/// Stops watching and drops changes poll() did not pick up yet
+	/// </summary>
+	void stop();
+
+	/// <summary>
+	/// Reloads the loaded config from its own path if it was edited since it was last loaded or
+	/// saved, applying only the changed items through reload_file. Edits of other files in the
+	/// directory are ignored.
+	/// </summary>
+	/// <returns>Number of changed items</returns>
+	size_t poll();
+
+	/// <summary>
+	/// Gets the reload counters and latencies
+	/// </summary>
+	/// <returns>Reload statistics</returns>
+	stats_t get_stats();
+}
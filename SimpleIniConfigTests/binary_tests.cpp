@@ -0,0 +1,88 @@
+#include "harness.h"
+#include "config.h"
+#include "binary.h"
+#include "stats.h"
+#include <thread>
+
+namespace
+{
+	ADD_CFG_ITEM(int, number, 1, binary);
+	ADD_CFG_ITEM(std::string, text, std::string("default"), binary);
+	ADD_CFG_ITEM(std::vector<float>, floats, (std::vector<float>{ 0.5f }), binary);
+
+	uint64_t cache_hits()
+	{
+		return config::stats::get().counters[config::stats::CACHE_HITS];
+	}
+}
+
+TEST_CASE(binary_snapshot_used_while_fresh)
+{
+	const auto dir = harness::temp_dir("binary");
+	config::set_config_directory(dir.string());
+	c_binary_number.set(42);
+	c_binary_text.set(std::string("saved"));
+	c_binary_floats.set(std::vector<float>{ 1.5f, -2.0f });
+	CHECK(config::save("profile", config::SAVE_SNAPSHOT));
+	CHECK(std::filesystem::exists(dir / "profile.bin"));
+
+	c_binary_number.set(0);
+	c_binary_text.set(std::string());
+	const uint64_t hits = cache_hits();
+	CHECK(config::load_settings("profile"));
+	CHECK(cache_hits() == hits + 1);
+	CHECK(c_binary_number.get() == 42 && c_binary_text.get() == "saved");
+	CHECK(c_binary_floats.get() == (std::vector<float>{ 1.5f, -2.0f }));
+
+	// an edited ini makes the snapshot stale, the ini wins
+	std::string ini = harness::read_file(dir / "profile");
+	ini.replace(ini.find("number=42"), 9, "number=7");
+	harness::write_file(dir / "profile", ini);
+	CHECK(config::load_settings("profile"));
+	CHECK(cache_hits() == hits + 1);
+	CHECK(c_binary_number.get() == 7);
+
+	// a converted snapshot keeps text records and applies them through the codecs
+	CHECK(config::binary::convert((dir / "profile").string(), (dir / "profile.bin").string()));
+	c_binary_number.set(0);
+	CHECK(config::load_settings("profile"));
+	CHECK(cache_hits() == hits + 2 && c_binary_number.get() == 7);
+
+	// a truncated snapshot is ignored
+	std::string bin = harness::read_file(dir / "profile.bin");
+	harness::write_file(dir / "profile.bin", std::string_view(bin).substr(0, bin.size() / 2));
+	c_binary_number.set(0);
+	CHECK(config::load_settings("profile"));
+	CHECK(cache_hits() == hits + 2 && c_binary_number.get() == 7);
+}
+
+BENCH_CASE(binary_load_cold_and_warm)
+{
+	for (size_t i = 0; i < 20000; ++i)
+	{
+		const std::string name = "value" + std::to_string(i);
+		if (i % 4 == 0)
+			config::add_item<shared::col_t>(name, CT_HASH("shared::col_t"), shared::col_t(int(i % 256), 1, 2, 3), "binarybench");
+		else if (i % 4 == 1)
+			config::add_item<std::vector<float>>(name, CT_HASH("std::vector<float>"), std::vector<float>(4, float(i) * 0.1f), "binarybench");
+		else
+			config::add_item<float>(name, CT_HASH("float"), float(i) * 0.25f, "binarybench");
+	}
+
+	const auto dir = harness::temp_dir("binarybench");
+	config::set_config_directory(dir.string());
+	config::save("ini", config::SAVE_FAST);
+	config::save("bin", config::SAVE_FAST | config::SAVE_SNAPSHOT);
+	const std::string label = " (" + std::to_string(config::get_items().size()) + " items)";
+
+	// cold is the first load after the files were written, warm the best of three more
+	for (const char* name : { "ini", "bin" })
+	{
+		const auto start = std::chrono::steady_clock::now();
+		config::load_settings(name);
+		const double cold = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		const double warm = harness::time_per_op(1, [name](size_t) { config::load_settings(name); }) / 1e6;
+		harness::report(std::string(name) + " cold load" + label, cold, "ms");
+		harness::report(std::string(name) + " warm load" + label, warm, "ms");
+	}
+}
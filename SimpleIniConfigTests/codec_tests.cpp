@@ -0,0 +1,121 @@
+#include "harness.h"
+#include "config.h"
+#include "numconv.h"
+
+namespace
+{
+	ADD_CFG_ITEM(int, number, 10, codecs);
+	ADD_CFG_ITEM(std::vector<int>, numbers, (std::vector<int>{ 1, 2, 3 }), codecs);
+	ADD_CFG_ITEM(shared::col_t, color, shared::col_t(1, 2, 3, 4), codecs);
+
+	struct sample_t
+	{
+		const char* type;
+		const char* text; // formats back to the same text
+	};
+
+	const sample_t SAMPLES[] = {
+		{ "bool", "true" },
+		{ "int", "-123456" },
+		{ "float", "0.1" },
+		{ "shared::col_t", "255,128,0,64" },
+		{ "std::string", "some text value" },
+		{ "std::vector<int>", "1,-2,3,40000,5,6,7,8" },
+		{ "std::vector<float>", "0.5,1.25,-3,1e+20,0.1,2,3,4" },
+		{ "AmiKeyBind", "112" },
+	};
+}
+
+TEST_CASE(codecs_round_trip)
+{
+	for (const auto& sample : SAMPLES)
+	{
+		const auto* codec = config::find_codec(shared::hash::get(sample.type));
+		CHECK(codec);
+
+		config::value_t value;
+		CHECK(codec->parse(sample.text, value));
+		std::string text;
+		codec->format(value, text);
+		CHECK(text == sample.text);
+
+		if (codec->encode)
+		{
+			std::string bytes;
+			codec->encode(value, bytes);
+			config::value_t decoded;
+			CHECK(codec->decode(bytes, decoded));
+			std::string decoded_text;
+			codec->format(decoded, decoded_text);
+			CHECK(decoded_text == sample.text);
+		}
+	}
+}
+
+TEST_CASE(codecs_reject_without_touching_the_item)
+{
+	const auto* codec = config::find_codec(CT_HASH("std::vector<int>"));
+	config::value_t value = config::make_value(std::vector<int>{ 7, 8, 9 });
+	config::value_t scratch;
+	CHECK(!config::convert_checked(codec->parse, "1,2,x", value, scratch));
+	CHECK(std::get<std::vector<int>>(value) == (std::vector<int>{ 7, 8, 9 }));
+
+	// a load keeps the current value of every item whose text is rejected
+	const auto dir = harness::temp_dir("codecs");
+	config::set_config_directory(dir.string());
+	c_codecs_number.set(10);
+	c_codecs_numbers.set(std::vector<int>{ 1, 2, 3 });
+	const std::vector<int>* numbers = &c_codecs_numbers.get();
+	harness::write_file(dir / "bad", "[codecs]\nnumber=12abc\nnumbers=4,5,six\ncolor=#0A0B0C0D\n");
+	CHECK(config::load_settings("bad"));
+	CHECK(c_codecs_number.get() == 10);
+	CHECK(c_codecs_numbers.get() == (std::vector<int>{ 1, 2, 3 }));
+	CHECK(&c_codecs_numbers.get() == numbers);
+	CHECK(c_codecs_color.get().r() == 10 && c_codecs_color.get().a() == 13);
+	CHECK(config::get_item(c_codecs_number).is_dirty() && !config::get_item(c_codecs_color).is_dirty());
+}
+
+TEST_CASE(codecs_parse_colors_and_lists)
+{
+	shared::col_t col;
+	CHECK(shared::num::parse_color("#FF800040", col) && col.r() == 255 && col.g() == 128 && col.b() == 0 && col.a() == 64);
+	CHECK(shared::num::parse_color("#102030", col) && col.b() == 0x30 && col.a() == 255);
+	CHECK(shared::num::parse_color(" 1, 2 ,3,4 ", col) && col.r() == 1 && col.a() == 4);
+	CHECK(!shared::num::parse_color("1,2,3", col) && !shared::num::parse_color("1,2,3,4,5", col) && !shared::num::parse_color("#12345", col));
+
+	int val = 0;
+	CHECK(!shared::num::parse("+-5", val) && !shared::num::parse("++5", val) && val == 0);
+	size_t count = 0;
+	const auto counter = [&count](int) { ++count; return true; };
+	CHECK(shared::num::parse_list<int>("1, +2,-3,", counter) && count == 3);
+	CHECK(!shared::num::parse_list<int>("1,+-2", counter));
+	CHECK(!shared::num::parse_list<int>("1,,2", counter));
+
+	// a rejected list leaves the vector as it was, even without convert_checked
+	const auto* codec = config::find_codec(CT_HASH("std::vector<float>"));
+	config::value_t value = config::make_value(std::vector<float>{ 1.0f, 2.0f });
+	CHECK(!codec->parse("3,4,oops", value));
+	CHECK(std::get<std::vector<float>>(value) == (std::vector<float>{ 1.0f, 2.0f }));
+	CHECK(codec->parse("5", value) && std::get<std::vector<float>>(value) == (std::vector<float>{ 5.0f }));
+}
+
+BENCH_CASE(codecs_throughput)
+{
+	constexpr size_t ITERATIONS = 2'000'000;
+	for (const auto& sample : SAMPLES)
+	{
+		const auto* codec = config::find_codec(shared::hash::get(sample.type));
+		config::value_t value;
+		codec->parse(sample.text, value);
+
+		const std::string_view text = sample.text;
+		const double parse_ns = harness::time_per_op(ITERATIONS, [&](size_t) { harness::keep(codec->parse(text, value)); });
+		std::string out;
+		const double format_ns = harness::time_per_op(ITERATIONS, [&](size_t) {
+			out.clear();
+			codec->format(value, out);
+		});
+		harness::report(std::string(sample.type) + " parse", parse_ns, "ns");
+		harness::report(std::string(sample.type) + " format", format_ns, "ns");
+	}
+}
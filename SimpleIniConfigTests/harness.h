@@ -0,0 +1,99 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// Minimal test and benchmark runner. Tests run on every start, benchmarks only with "bench" on
+// the command line. Any other argument keeps the cases whose name contains it, e.g.
+// SimpleIniConfigTests.exe bench codec
+namespace harness
+{
+	using case_fn_t = void(*)();
+
+	/// <summary>
+	/// Adds a case to the runner, used by TEST_CASE and BENCH_CASE
+	/// </summary>
+	struct registrar_t
+	{
+		registrar_t(const char* name, case_fn_t fn, const bool bench);
+	};
+
+	/// <summary>
+	/// Fails the running case, used by CHECK
+	/// </summary>
+	[[noreturn]] void fail(const char* expr, const char* file, const int line);
+
+	/// <summary>
+	/// Prints one benchmark result line, e.g. "  scalar: 1250.3 MB/s"
+	/// </summary>
+	void report(const std::string_view label, const double value, const std::string_view unit);
+
+	/// <summary>
+	/// Creates an empty directory for a case below the temp directory
+	/// </summary>
+	/// <param name="name">Name of the directory, reused and emptied by later runs</param>
+	std::filesystem::path temp_dir(const std::string_view name);
+
+	/// <summary>
+	/// Writes text to a file, replacing it
+	/// </summary>
+	void write_file(const std::filesystem::path& path, const std::string_view text);
+
+	/// <summary>
+	/// Reads a whole file, empty if it does not exist
+	/// </summary>
+	std::string read_file(const std::filesystem::path& path);
+
+	/// <summary>
+	/// Keeps the compiler from dropping a computation whose result is otherwise unused
+	/// </summary>
+	void keep_address(const void* address);
+
+	template< typename t >
+	void keep(const t& value)
+	{
+		keep_address(&value);
+	}
+
+	/// <summary>
+	/// Number of operator new calls on the calling thread so far, compare two readings around the code under test
+	/// </summary>
+	size_t allocation_count();
+
+	/// <summary>
+	/// Runs fn iterations times, best of three runs
+	/// </summary>
+	/// <returns>Nanoseconds per iteration</returns>
+	template< typename fn_t >
+	double time_per_op(const size_t iterations, fn_t&& fn)
+	{
+		double best = 0.0;
+		for (int run = 0; run < 3; ++run)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < iterations; ++i)
+				fn(i);
+			const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / double(iterations);
+			best = run == 0 ? ns : std::min(best, ns);
+		}
+		return best;
+	}
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static const harness::registrar_t name##_registrar(#name, name, false); \
+	static void name()
+
+#define BENCH_CASE(name) \
+	static void name(); \
+	static const harness::registrar_t name##_registrar(#name, name, true); \
+	static void name()
+
+#define CHECK(expr) \
+	do { \
+		if (!(expr)) \
+			harness::fail(#expr, __FILE__, __LINE__); \
+	} while (0)
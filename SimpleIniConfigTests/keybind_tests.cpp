@@ -0,0 +1,368 @@
+#include "harness.h"
+#include "config.h"
+#include "kbinds.h"
+#include "numconv.h"
+#include "observer.h"
+#include "snapshot.h"
+#include "stats.h"
+#include <atomic>
+#include <thread>
+
+namespace
+{
+	// custom type behind std::any, names are longer than any small string buffer
+	struct profile_t
+	{
+		std::string name;
+		int level = 0;
+	};
+
+	bool parse_profile(std::string_view text, profile_t& out)
+	{
+		const size_t colon = text.find(':');
+		int level;
+		if (colon == std::string_view::npos || !shared::num::parse(text.substr(colon + 1), level))
+			return false;
+		out.name.assign(text.substr(0, colon));
+		out.level = level;
+		return true;
+	}
+
+	void format_profile(const profile_t& in, std::string& out)
+	{
+		out += in.name;
+		out += ':';
+		shared::num::append(out, in.level);
+	}
+
+	ADD_CFG_ITEM(int, level, 0, keys);
+	ADD_CFG_ITEM(float, scale, 1.0f, keys);
+	ADD_CFG_ITEM(int, frame, 0, keys);
+	ADD_CFG_ITEM(std::string, label, std::string(), keys);
+	ADD_CFG_ITEM(std::vector<float>, weights, std::vector<float>{}, keys);
+	ADD_CFG_ITEM(profile_t, profile, (profile_t{ "default", 0 }), keys);
+
+	constexpr std::string_view DEFAULT_BINDS = "F1=OnPress:keys.level=1|OnRelease:keys.level=0\nF2=OnPress:keys.scale=2.5\n";
+
+	/// <summary>
+	/// Writes the key names and a bind file for the keys section, loads the names into gMenuKeyData
+	/// </summary>
+	/// <returns>Path of the bind file</returns>
+	std::string write_binds(const std::string_view name, const std::string_view binds = DEFAULT_BINDS)
+	{
+		const auto dir = harness::temp_dir(name);
+		harness::write_file(dir / "UiAndKeyData", "[KeyNames]\n1=LBUTTON\n112=F1\n113=F2\n");
+		harness::write_file(dir / "keybinds", "[KeyBinder]\nHotKey=LBUTTON\n[KeyBinds]\n" + std::string(binds));
+		gMenuKeyData = LoadMenuAndKeyNames((dir / "UiAndKeyData").string());
+		return (dir / "keybinds").string();
+	}
+
+	constexpr std::string_view TYPED_BINDS =
+		"F1=OnPress:keys.level=1|OnPress:keys.label=a label longer than any small string buffer|OnPress:keys.weights=0.5,1.5,2.5,3.5"
+		"|OnPress:keys.profile=a profile name longer than a small string:3"
+		"|OnRelease:keys.level=0|OnRelease:keys.label=released and still too long for a small string|OnRelease:keys.weights=4.5,5.5"
+		"|OnRelease:keys.profile=the released profile with a long name:0\n";
+}
+
+TEST_CASE(keybinds_apply_on_the_polling_thread)
+{
+	constexpr int PRESSES = 200;
+	std::vector<input::replay_source_t::event_t> script;
+	for (int i = 0; i < PRESSES; ++i)
+	{
+		script.push_back({ std::chrono::milliseconds(2 * i + 1), input::vk::F1, true });
+		script.push_back({ std::chrono::milliseconds(2 * i + 2), input::vk::F1, false });
+	}
+	script.push_back({ std::chrono::milliseconds(1000), input::vk::F1 + 1, true });
+	input::set_source(std::make_shared<input::replay_source_t>(script));
+
+	const auto owner = std::this_thread::get_id();
+	int notifications = 0;
+	int foreign = 0;
+	const uint32_t subscription = config::subscribe(c_keys_level.index(), [&](std::span<const uint32_t>) {
+		++notifications;
+		foreign += std::this_thread::get_id() != owner;
+	});
+
+	FkeyBinds binds(write_binds("keybinds_threads"));
+	std::atomic<bool> done = false;
+	std::atomic<int> invalid = 0;
+	std::thread dispatcher([&binds] { binds.run(); });
+	std::thread reader([&] {
+		while (!done.load(std::memory_order_relaxed))
+		{
+			config::read_guard guard;
+			const int* level = guard.find<int>(c_keys_level.index());
+			if (level && *level != 0 && *level != 1)
+				invalid.fetch_add(1);
+		}
+	});
+
+	// the owner keeps setting its own items while binds come in from the dispatcher
+	size_t applied = 0;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+	for (int frame = 0; applied < 2 * PRESSES + 1 && std::chrono::steady_clock::now() < deadline; ++frame)
+	{
+		c_keys_frame.set(frame);
+		config::publish();
+		applied += binds.poll();
+	}
+
+	binds.stop();
+	dispatcher.join();
+	done = true;
+	reader.join();
+	input::set_source(nullptr);
+	config::unsubscribe(subscription);
+
+	CHECK(applied == 2 * PRESSES + 1);
+	CHECK(invalid == 0);
+	CHECK(c_keys_level.get() == 0 && c_keys_scale.get() == 2.5f);
+	CHECK(notifications > 0 && foreign == 0);
+}
+
+TEST_CASE(keybinds_replay_script_sets_items)
+{
+	auto replay = input::replay_source_t::parse("1 112 down\n5 112 up\n10 113 down\n12 113 up\n");
+	CHECK(replay);
+	input::set_source(replay);
+	c_keys_level.set(0);
+	c_keys_scale.set(1.0f);
+
+	FkeyBinds binds(write_binds("keybinds_replay"));
+	const auto step = [&](const int ms) {
+		replay->advance(std::chrono::milliseconds(ms));
+		binds.checkKeysOnce();
+		return binds.poll();
+	};
+
+	CHECK(step(0) == 0 && c_keys_level.get() == 0);
+	CHECK(step(1) == 1 && c_keys_level.get() == 1);
+	CHECK(step(3) == 0 && c_keys_level.get() == 1);
+	CHECK(step(1) == 1 && c_keys_level.get() == 0);
+	CHECK(step(5) == 1 && c_keys_scale.get() == 2.5f);
+	CHECK(step(2) == 1 && c_keys_scale.get() == 2.5f);
+	CHECK(replay->finished());
+	{
+		config::read_guard guard;
+		CHECK(guard.get(c_keys_level) == 0 && guard.get(c_keys_scale) == 2.5f);
+	}
+
+	// key bind recording reads the same source
+	AmiKeyBind recorded;
+	recorded.startRecording();
+	replay->set(input::vk::F1, true);
+	recorded.recordKeyPress();
+	CHECK(!recorded.isRecording() && recorded.Get() == input::vk::F1 && recorded.isDown());
+
+	// a source taken before set_source replaces it stays usable
+	const auto held = input::get_source();
+	input::set_source(nullptr);
+	CHECK(held == replay && held->is_down(input::vk::F1));
+	replay->set(input::vk::F1, false);
+}
+
+TEST_CASE(keybinds_stop_interrupts_the_running_source)
+{
+	auto running = std::make_shared<input::replay_source_t>(); // no events, run() blocks on it
+	input::set_source(running);
+	FkeyBinds binds(write_binds("keybinds_stop"));
+	std::atomic<bool> returned = false;
+	std::thread dispatcher([&] {
+		binds.run();
+		returned = true;
+	});
+	while (running.use_count() < 3) // held by the test, get_source's copy in run() and runningSource
+		std::this_thread::yield();
+
+	// replacing the source must neither destroy the one run() waits on nor keep stop() from waking it
+	input::set_source(std::make_shared<input::replay_source_t>());
+	binds.stop();
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!returned && std::chrono::steady_clock::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	const bool stopped = returned;
+	if (!stopped)
+		running->interrupt(); // do not leave the thread hanging on a failure
+	dispatcher.join();
+	input::set_source(nullptr);
+
+	CHECK(stopped);
+	CHECK(running.use_count() == 1);
+}
+
+BENCH_CASE(keybind_dispatch_latency)
+{
+	constexpr int PRESSES = 5000;
+	std::vector<input::replay_source_t::event_t> script;
+	for (int i = 0; i < PRESSES; ++i)
+	{
+		script.push_back({ std::chrono::milliseconds(2 * i + 1), input::vk::F1, true });
+		script.push_back({ std::chrono::milliseconds(2 * i + 2), input::vk::F1, false });
+	}
+	const std::string path = write_binds("keybind_latency");
+
+	// every applied change publishes all items, so earlier benches that registered many show up here
+	const std::string items = " (" + std::to_string(config::get_items().size()) + " items)";
+	const auto report = [&items](const std::string& mode) {
+		const auto histogram = config::stats::get().phases[config::stats::PHASE_DISPATCH];
+		harness::report(mode + " p50" + items, double(histogram.percentile_ns(0.5)) / 1e3, "us");
+		harness::report(mode + " p99" + items, double(histogram.percentile_ns(0.99)) / 1e3, "us");
+		harness::report(mode + " max" + items, double(histogram.max_ns) / 1e3, "us");
+	};
+
+	// from the source seeing a change to poll having applied it. The owner schedules one change at a
+	// time, so every change crosses from the woken dispatcher to the polling owner on its own.
+	{
+		auto replay = std::make_shared<input::replay_source_t>();
+		input::set_source(replay);
+		FkeyBinds binds(path);
+		config::stats::reset();
+		std::thread dispatcher([&binds] { binds.run(); });
+		for (int i = 0; i < 2 * PRESSES; ++i)
+		{
+			replay->schedule({ std::chrono::milliseconds(i + 1), input::vk::F1, i % 2 == 0 });
+			while (binds.poll() == 0)
+				std::this_thread::yield();
+		}
+		binds.stop();
+		dispatcher.join();
+		report("two threads");
+	}
+	{
+		auto replay = std::make_shared<input::replay_source_t>(script);
+		input::set_source(replay);
+		FkeyBinds binds(path);
+		config::stats::reset();
+		while (!replay->finished())
+		{
+			replay->wait_for_change();
+			binds.checkKeysOnce();
+			binds.poll();
+		}
+		report("one thread");
+	}
+	input::set_source(nullptr);
+	config::stats::reset();
+}
+
+TEST_CASE(keybinds_press_does_not_allocate)
+{
+	config::register_type<profile_t, parse_profile, format_profile>(CT_HASH("profile_t"));
+	auto replay = std::make_shared<input::replay_source_t>();
+	input::set_source(replay);
+	FkeyBinds binds(write_binds("keybinds_alloc", TYPED_BINDS));
+	const auto press = [&](const bool down) {
+		replay->set(input::vk::F1, down);
+		binds.checkKeysOnce();
+		return binds.poll();
+	};
+
+	// the first rounds fill the spare snapshots and grow the value buffers to their final size
+	for (int i = 0; i < 4; ++i)
+		press(true), press(false);
+
+	// publish copies the std::any items of other tests too, their types have no codec to assign in
+	// place. The first publish after the presses still settles the spare snapshots.
+	config::publish();
+	size_t allocations = harness::allocation_count();
+	config::publish();
+	const size_t publish_allocations = harness::allocation_count() - allocations;
+
+	constexpr size_t ROUNDS = 100;
+	size_t applied = 0;
+	allocations = harness::allocation_count();
+	for (size_t i = 0; i < ROUNDS; ++i)
+		applied += press(true) + press(false);
+	allocations = harness::allocation_count() - allocations;
+	input::set_source(nullptr);
+
+	CHECK(applied == 2 * ROUNDS);
+	CHECK(allocations == 2 * ROUNDS * publish_allocations);
+	CHECK(c_keys_level.get() == 0 && c_keys_label.get() == "released and still too long for a small string");
+	CHECK(c_keys_weights.get() == (std::vector<float>{ 4.5f, 5.5f }));
+	CHECK(config::get<profile_t>(c_keys_profile).name == "the released profile with a long name");
+	config::read_guard guard;
+	CHECK(guard.get(c_keys_profile).level == 0 && guard.get(c_keys_label) == c_keys_label.get());
+}
+
+BENCH_CASE(keybind_press_cost)
+{
+	config::register_type<profile_t, parse_profile, format_profile>(CT_HASH("profile_t"));
+	auto replay = std::make_shared<input::replay_source_t>();
+	input::set_source(replay);
+	FkeyBinds binds(write_binds("keybind_press", TYPED_BINDS));
+	const std::string label = " (" + std::to_string(config::get_items().size()) + " items published)";
+
+	// a press or release of a key with four typed binds, from the snapshot to the published change
+	const double ns = harness::time_per_op(20000, [&](size_t i) {
+		replay->set(input::vk::F1, i % 2 == 0);
+		binds.checkKeysOnce();
+		binds.poll();
+	});
+	const double publish_ns = harness::time_per_op(20000, [](size_t) { config::publish(); });
+	input::set_source(nullptr);
+
+	harness::report("press with four binds" + label, ns, "ns");
+	harness::report("of which publish" + label, publish_ns, "ns");
+}
+
+TEST_CASE(key_names_follow_the_source)
+{
+	// names of its own for F1, everything else from the default table
+	struct named_source_t : input::replay_source_t
+	{
+		std::string key_name(const int key) override
+		{
+			return key == input::vk::F1 ? "Custom F1" : input::default_key_name(key);
+		}
+	};
+
+	input::set_source(std::make_shared<input::replay_source_t>());
+	const std::string& before = input::get_key_name(input::vk::F1);
+	CHECK(before == "F1" && input::find_key_code("F1") == input::vk::F1);
+
+	input::set_source(std::make_shared<named_source_t>());
+	CHECK(input::get_key_name(input::vk::F1) == "Custom F1");
+	CHECK(input::find_key_code("Custom F1") == input::vk::F1 && input::find_key_code("F1") == -1);
+	CHECK(before == "F1"); // tables of earlier sources stay alive
+	CHECK(&input::get_key_name(input::vk::F1) == &input::get_key_name(input::vk::F1));
+	CHECK(AmiKeyBind(input::vk::F1).toString() == "Custom F1");
+
+	// bind files name keys from the KeyNames section or else as toString shows them
+	input::set_source(nullptr);
+	write_binds("key_names");
+	CHECK(gMenuKeyData.findKeyCode("LBUTTON") == input::vk::LBUTTON);
+	CHECK(gMenuKeyData.findKeyCode(input::get_key_name(input::vk::F1 + 3)) == input::vk::F1 + 3);
+	CHECK(gMenuKeyData.findKeyCode("no such key") == -1);
+	CHECK(input::find_key_code("Unknown Key: 255") == -1);
+}
+
+TEST_CASE(keybinds_stop_without_a_running_loop_is_ignored)
+{
+	auto replay = std::make_shared<input::replay_source_t>();
+	input::set_source(replay);
+	c_keys_level.set(0);
+	FkeyBinds binds(write_binds("keybinds_stop_idle"));
+	binds.stop(); // nothing runs yet
+
+	for (int round = 0; round < 2; ++round)
+	{
+		std::thread dispatcher([&binds] { binds.run(); });
+		replay->schedule({ replay->now() + std::chrono::milliseconds(1), input::vk::F1, true });
+		size_t applied = 0;
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (applied == 0 && std::chrono::steady_clock::now() < deadline)
+			applied += binds.poll();
+		CHECK(applied == 1 && c_keys_level.get() == 1);
+
+		replay->schedule({ replay->now() + std::chrono::milliseconds(1), input::vk::F1, false });
+		while (c_keys_level.get() != 0 && std::chrono::steady_clock::now() < deadline)
+			binds.poll();
+		binds.stop();
+		dispatcher.join();
+		CHECK(c_keys_level.get() == 0);
+		binds.stop(); // after run() returned, must not end the next round early
+	}
+	input::set_source(nullptr);
+}
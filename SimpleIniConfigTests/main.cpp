@@ -0,0 +1,147 @@
+#include "harness.h"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <vector>
+
+namespace harness
+{
+	namespace
+	{
+		const void* volatile sink = nullptr;
+		thread_local size_t allocations = 0;
+
+		struct case_t
+		{
+			const char* name;
+			case_fn_t fn;
+			bool bench;
+		};
+
+		std::vector<case_t>& get_cases()
+		{
+			static std::vector<case_t> cases;
+			return cases;
+		}
+
+		struct failure_t
+		{
+			std::string message;
+		};
+	}
+
+	registrar_t::registrar_t(const char* name, case_fn_t fn, const bool bench)
+	{
+		get_cases().push_back(case_t{ name, fn, bench });
+	}
+
+	void fail(const char* expr, const char* file, const int line)
+	{
+		throw failure_t{ std::string(file) + ':' + std::to_string(line) + ": CHECK(" + expr + ") failed" };
+	}
+
+	void keep_address(const void* address)
+	{
+		sink = address;
+	}
+
+	size_t allocation_count()
+	{
+		return allocations;
+	}
+
+	void report(const std::string_view label, const double value, const std::string_view unit)
+	{
+		std::printf("  %-40.*s %12.2f %.*s\n", int(label.size()), label.data(), value, int(unit.size()), unit.data());
+	}
+
+	std::filesystem::path temp_dir(const std::string_view name)
+	{
+		const auto dir = std::filesystem::temp_directory_path() / "SimpleIniConfigTests" / name;
+		std::error_code err;
+		std::filesystem::remove_all(dir, err);
+		std::filesystem::create_directories(dir);
+		return dir;
+	}
+
+	void write_file(const std::filesystem::path& path, const std::string_view text)
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out.write(text.data(), std::streamsize(text.size()));
+	}
+
+	std::string read_file(const std::filesystem::path& path)
+	{
+		std::ifstream in(path, std::ios::binary);
+		return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+	}
+}
+
+// counts for allocation_count, every other new and delete forwards to these
+void* operator new(const std::size_t size)
+{
+	++harness::allocations;
+	if (void* memory = std::malloc(size ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+int main(int argc, char** argv)
+{
+	bool benchmarks = false;
+	std::string filter;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::string_view(argv[i]) == "bench")
+			benchmarks = true;
+		else
+			filter = argv[i];
+	}
+
+	int failed = 0, run = 0;
+	for (const bool bench : { false, true })
+	{
+		if (bench && !benchmarks)
+			break;
+
+		for (const auto& test : harness::get_cases())
+		{
+			if (test.bench != bench || std::string_view(test.name).find(filter) == std::string_view::npos)
+				continue;
+
+			std::printf("%s %s\n", bench ? "[bench]" : "[test ]", test.name);
+			std::fflush(stdout);
+			++run;
+			try
+			{
+				test.fn();
+			}
+			catch (const harness::failure_t& failure)
+			{
+				std::printf("  FAILED %s\n", failure.message.c_str());
+				++failed;
+			}
+			catch (const std::exception& err)
+			{
+				std::printf("  FAILED exception: %s\n", err.what());
+				++failed;
+			}
+		}
+	}
+
+	std::printf("%d of %d cases passed\n", run - failed, run);
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+#include "harness.h"
+#include "config.h"
+#include "numconv.h"
+#include <cstring>
+#include <random>
+
+namespace
+{
+	constexpr size_t NUMERIC_KEYS = 100'000;
+
+	/// <summary>
+	/// Registers NUMERIC_KEYS items, alternating int and float, once per process
+	/// </summary>
+	void register_numeric_items()
+	{
+		static bool registered = false;
+		if (registered)
+			return;
+		registered = true;
+
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> floats(-1000.0f, 1000.0f);
+		for (size_t i = 0; i < NUMERIC_KEYS; ++i)
+		{
+			const std::string name = "key" + std::to_string(i);
+			if (i % 2)
+				config::add_item<float>(name, CT_HASH("float"), floats(rng), "numeric");
+			else
+				config::add_item<int>(name, CT_HASH("int"), int(rng()), "numeric");
+		}
+	}
+}
+
+TEST_CASE(numbers_round_trip_shortest)
+{
+	std::string text;
+	shared::num::append(text, 0.1f);
+	CHECK(text == "0.1");
+
+	std::mt19937 rng(3);
+	for (int i = 0; i < 100000; ++i)
+	{
+		const uint32_t bits = rng();
+		float val;
+		std::memcpy(&val, &bits, sizeof(val));
+		if (val != val || val - val != 0.0f)
+			continue; // nan and inf
+
+		text.clear();
+		shared::num::append(text, val);
+		float parsed = 0.0f;
+		CHECK(shared::num::parse(text, parsed) && parsed == val);
+	}
+
+	int number = 5;
+	CHECK(shared::num::parse("+42", number) && number == 42);
+	CHECK(!shared::num::parse("42 ", number) && number == 42);
+	CHECK(!shared::num::parse("", number) && !shared::num::parse("0x10", number));
+}
+
+BENCH_CASE(numbers_load_save_100k)
+{
+	register_numeric_items();
+	const auto dir = harness::temp_dir("numeric");
+	config::set_config_directory(dir.string());
+
+	// the conversions load and save used before, std::stof/stoi and std::to_string
+	std::vector<std::string> texts;
+	texts.reserve(NUMERIC_KEYS);
+	for (size_t i = 0; i < NUMERIC_KEYS; ++i)
+	{
+		texts.push_back(std::to_string(float(i) * 0.37f));
+	}
+	float sum = 0.0f;
+	harness::report("std::stof, per value", harness::time_per_op(NUMERIC_KEYS, [&](size_t i) { sum += std::stof(texts[i]); }), "ns");
+	harness::report("shared::num::parse<float>, per value", harness::time_per_op(NUMERIC_KEYS, [&](size_t i) {
+		float val;
+		shared::num::parse(texts[i], val);
+		sum += val;
+	}), "ns");
+	std::string out;
+	harness::report("std::to_string(float), per value", harness::time_per_op(NUMERIC_KEYS, [&](size_t i) { out = std::to_string(float(i) * 0.37f); }), "ns");
+	harness::report("shared::num::append<float>, per value", harness::time_per_op(NUMERIC_KEYS, [&](size_t i) {
+		out.clear();
+		shared::num::append(out, float(i) * 0.37f);
+	}), "ns");
+	harness::keep(sum);
+
+	const size_t items = config::get_items().size();
+	harness::report("config::save of " + std::to_string(items) + " items", harness::time_per_op(1, [](size_t) { config::save("numeric", config::SAVE_FAST); }) / 1e6, "ms");
+	harness::report("config::load_settings of the same file", harness::time_per_op(1, [](size_t) { config::load_settings("numeric"); }) / 1e6, "ms");
+}
@@ -0,0 +1,102 @@
+#include "harness.h"
+#include "iniconfig.h"
+#include <random>
+
+namespace
+{
+	const char* const KERNELS[] = { "scalar", "sse2", "avx2" };
+
+	/// <summary>
+	/// Generates an ini of roughly size bytes with keys of varying length, comments and blank lines
+	/// </summary>
+	std::string generate_ini(const size_t size, const uint32_t seed)
+	{
+		std::mt19937 rng(seed);
+		std::string text;
+		text.reserve(size + 256);
+		size_t line = 0;
+		while (text.size() < size)
+		{
+			if (line % 64 == 0)
+				text += "[section" + std::to_string(line / 64) + "]\n";
+			else if (line % 17 == 0)
+				text += "; comment line " + std::string(rng() % 40, 'c') + "\n";
+			else if (line % 23 == 0)
+				text += "\n";
+			else
+				text += "key" + std::to_string(line) + std::string(rng() % 24, 'k') + " = " + std::string(rng() % 48, 'v') + "=tail\n";
+			++line;
+		}
+		return text;
+	}
+
+	struct parsed_t
+	{
+		size_t keys = 0;
+		size_t bytes = 0; // summed view sizes, catches views that end in the wrong place
+	};
+
+	parsed_t parse(const std::string_view text)
+	{
+		parsed_t parsed;
+		ini::INIParser::parse_view(text, [&parsed](std::string_view section, std::string_view key, std::string_view value) {
+			++parsed.keys;
+			parsed.bytes += section.size() + key.size() + value.size();
+		});
+		return parsed;
+	}
+}
+
+TEST_CASE(parser_kernels_agree)
+{
+	const std::string text = generate_ini(64 * 1024, 6);
+	CHECK(ini::scan::select_kernel("scalar"));
+	const parsed_t expected = parse(text);
+	CHECK(expected.keys > 1000);
+
+	for (const char* kernel : KERNELS)
+	{
+		if (!ini::scan::select_kernel(kernel))
+			continue;
+
+		const parsed_t parsed = parse(text);
+		CHECK(parsed.keys == expected.keys && parsed.bytes == expected.bytes);
+
+		// every line length around the block widths, with and without a trailing newline
+		for (size_t len = 0; len < 70; ++len)
+		{
+			const std::string line = "k" + std::string(len, 'x') + "=v";
+			size_t separator;
+			CHECK(ini::scan::find_line(line, 0, separator) == line.size() && separator == len + 1);
+			CHECK(ini::scan::find_line(line + "\nnext=1", 0, separator) == line.size() && separator == len + 1);
+		}
+	}
+	ini::scan::select_kernel({});
+}
+
+TEST_CASE(parser_trims_and_skips)
+{
+	size_t keys = 0;
+	ini::INIParser::parse_view("; comment\n[a]\r\n  key =  value \r\nnovalue\n#x=1\n[b]\nk=v=w", [&keys](std::string_view section, std::string_view key, std::string_view value) {
+		if (keys == 0)
+			CHECK(section == "a" && key == "key" && value == "value");
+		else
+			CHECK(section == "b" && key == "k" && value == "v=w");
+		++keys;
+	});
+	CHECK(keys == 2);
+}
+
+BENCH_CASE(parser_kernel_throughput)
+{
+	const std::string text = generate_ini(32 * 1024 * 1024, 6);
+	for (const char* kernel : KERNELS)
+	{
+		if (!ini::scan::select_kernel(kernel))
+			continue;
+
+		const double ns = harness::time_per_op(1, [&text](size_t) { harness::keep(parse(text)); });
+		harness::report(std::string(kernel) + " parse_view", double(text.size()) / ns * 1e3, "MB/s");
+	}
+	ini::scan::select_kernel({});
+}
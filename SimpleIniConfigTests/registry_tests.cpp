@@ -0,0 +1,46 @@
+#include "harness.h"
+#include "config.h"
+
+namespace
+{
+	/// <summary>
+	/// Registers count int items into their own section and returns the time per item
+	/// </summary>
+	double register_items(const std::string& section, const size_t count)
+	{
+		std::vector<std::string> names(count);
+		for (size_t i = 0; i < count; ++i)
+			names[i] = "item" + std::to_string(i);
+
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < count; ++i)
+			config::add_item<int>(names[i], CT_HASH("int"), int(i), section);
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / double(count);
+	}
+}
+
+TEST_CASE(registry_dedupes_items)
+{
+	const auto first = config::add_item<int>("dup", CT_HASH("int"), 1, "registry");
+	const auto again = config::add_item<int>("dup", CT_HASH("int"), 2, "registry");
+	const auto other_type = config::add_item<float>("dup", CT_HASH("float"), 3.0f, "registry");
+	const auto other_section = config::add_item<int>("dup", CT_HASH("int"), 4, "registry2");
+
+	CHECK(first == again);
+	CHECK(config::get<int>(first) == 1); // the first registration keeps its default
+	CHECK(other_type != first);
+	CHECK(other_section != first);
+	CHECK(config::does_item_exist("REGISTRY", "Dup") == int(first));
+	CHECK(config::does_item_exist("registry", "missing") < 0);
+}
+
+BENCH_CASE(registry_startup_scaling)
+{
+	// linear registration keeps the time per item flat as the registry grows
+	size_t section = 0;
+	for (const size_t count : { 1000u, 10000u, 50000u })
+	{
+		const double ns = register_items("scaling" + std::to_string(section++), count);
+		harness::report(std::to_string(count) + " items, per item", ns, "ns");
+	}
+}
@@ -0,0 +1,86 @@
+#include "harness.h"
+#include "config.h"
+#include "iniconfig.h"
+#include <future>
+
+namespace
+{
+	ADD_CFG_ITEM(int, counter, 0, async);
+	ADD_CFG_ITEM(std::string, label, std::string("first"), async);
+}
+
+TEST_CASE(async_saves_coalesce_until_flush)
+{
+	const auto dir = harness::temp_dir("async");
+	config::set_config_directory(dir.string());
+	CHECK(config::save("profile"));
+
+	// a long window keeps every request in one pending write until flush
+	config::set_save_debounce(std::chrono::hours(1));
+	c_async_counter.set(1);
+	const auto first = config::save_async("profile");
+	c_async_counter.set(2);
+	c_async_label.set(std::string("second"));
+	const auto second = config::save_async("profile");
+	CHECK(first.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+	CHECK(second.wait_for(std::chrono::milliseconds(0)) == std::future_status::timeout);
+	CHECK(harness::read_file(dir / "profile").find("counter=0") != std::string::npos);
+
+	CHECK(config::flush());
+	CHECK(first.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready && first.get() && second.get());
+	const std::string written = harness::read_file(dir / "profile");
+	CHECK(written.find("counter=2") != std::string::npos && written.find("label=second") != std::string::npos);
+
+	// the flushed items are clean again, so there is nothing left to queue
+	const auto idle = config::save_async("profile");
+	CHECK(idle.wait_for(std::chrono::milliseconds(0)) == std::future_status::ready && idle.get());
+	config::set_save_debounce(std::chrono::milliseconds(250));
+}
+
+TEST_CASE(single_writes_replace_the_file_atomically)
+{
+	namespace fs = std::filesystem;
+	const auto file = harness::temp_dir("singlewrite") / "settings.ini";
+	harness::write_file(file, "[main]\nkeep=1\nvalue=0\n");
+	fs::permissions(file, fs::perms::owner_read | fs::perms::owner_write);
+	const auto before = fs::status(file).permissions();
+
+	CHECK(ini::Write("main", "value", 7, file.string()));
+	CHECK(harness::read_file(file) == "[main]\nkeep=1\nvalue=7\n");
+	CHECK(fs::status(file).permissions() == before);
+	CHECK(!fs::exists(file.string() + ".tmp"));
+
+	// a missing directory fails the write instead of silently dropping it
+	CHECK(!ini::Write("main", "value", 8, (file.parent_path() / "missing" / "settings.ini").string()));
+}
+
+BENCH_CASE(async_save_caller_latency)
+{
+	for (size_t i = 0; i < 5000; ++i)
+		config::add_item<float>("value" + std::to_string(i), CT_HASH("float"), float(i), "asyncbench");
+
+	const auto dir = harness::temp_dir("asyncbench");
+	config::set_config_directory(dir.string());
+	config::save("profile");
+	config::set_save_debounce(std::chrono::hours(1));
+	const size_t changes = 200;
+	const std::string label = " (" + std::to_string(config::get_items().size()) + " items)";
+
+	// one changed item per call, what the calling thread pays for each save request
+	const double sync = harness::time_per_op(changes, [](size_t i) {
+		c_async_counter.set(int(i));
+		config::save_changes("profile");
+	});
+	const double async = harness::time_per_op(changes, [](size_t i) {
+		c_async_counter.set(int(i));
+		config::save_async("profile");
+	});
+	const auto start = std::chrono::steady_clock::now();
+	config::flush();
+	const double flush = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	config::set_save_debounce(std::chrono::milliseconds(250));
+
+	harness::report("save_changes per change" + label, sync / 1e3, "us");
+	harness::report("save_async per change" + label, async / 1e3, "us");
+	harness::report("flush of the coalesced write", flush, "us");
+}
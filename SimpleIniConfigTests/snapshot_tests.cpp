@@ -0,0 +1,121 @@
+#include "harness.h"
+#include "config.h"
+#include "snapshot.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	ADD_CFG_ITEM(int, first, 0, snapshot);
+	ADD_CFG_ITEM(int, second, 0, snapshot);
+	ADD_CFG_ITEM(std::vector<int>, list, std::vector<int>{}, snapshot);
+
+	/// <summary>
+	/// Sets the three items to the same round on the calling thread and publishes each round
+	/// </summary>
+	void publish_rounds(const int rounds)
+	{
+		for (int round = 1; round <= rounds; ++round)
+		{
+			c_snapshot_first.set(round);
+			c_snapshot_list.set(std::vector<int>(size_t(round % 16), round));
+			c_snapshot_second.set(round);
+			config::publish();
+		}
+	}
+}
+
+TEST_CASE(snapshots_stay_consistent_under_concurrent_publish)
+{
+	constexpr int ROUNDS = 20000;
+	std::atomic<bool> done = false;
+	std::atomic<int> torn = 0;
+	std::atomic<uint64_t> reads = 0;
+
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 3; ++i)
+	{
+		readers.emplace_back([&] {
+			uint64_t last_version = 0;
+			uint64_t count = 0;
+			while (!done.load(std::memory_order_relaxed))
+			{
+				config::read_guard guard;
+				const int* first = guard.find<int>(c_snapshot_first.index());
+				const int* second = guard.find<int>(c_snapshot_second.index());
+				const auto* list = guard.find<std::vector<int>>(c_snapshot_list.index());
+				if (!first || !second || !list)
+					continue; // nothing published yet
+
+				// every snapshot holds the values of one whole round, never a mix
+				const bool list_matches = list->size() == size_t(*first % 16) && std::all_of(list->begin(), list->end(), [first](int val) { return val == *first; });
+				if (*first != *second || !list_matches || guard.version() < last_version)
+					torn.fetch_add(1);
+				last_version = guard.version();
+				++count;
+			}
+			reads.fetch_add(count);
+		});
+	}
+
+	publish_rounds(ROUNDS);
+	done = true;
+	for (auto& reader : readers)
+		reader.join();
+
+	CHECK(torn == 0);
+	CHECK(reads > 0);
+	config::read_guard guard;
+	CHECK(guard.get(c_snapshot_first) == ROUNDS && guard.get(c_snapshot_second) == ROUNDS);
+}
+
+BENCH_CASE(snapshot_read_scaling)
+{
+	const unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+	config::publish();
+
+	// powers of two up to every core, readers run while the owner keeps publishing
+	std::vector<unsigned> steps;
+	for (unsigned threads = 1; threads < cores; threads *= 2)
+		steps.push_back(threads);
+	steps.push_back(cores);
+
+	for (const unsigned threads : steps)
+	{
+		constexpr auto DURATION = std::chrono::milliseconds(200);
+		std::atomic<bool> done = false;
+		std::atomic<uint64_t> reads = 0;
+		std::vector<std::thread> readers;
+		for (unsigned i = 0; i < threads; ++i)
+		{
+			readers.emplace_back([&] {
+				uint64_t count = 0;
+				int sum = 0;
+				while (!done.load(std::memory_order_relaxed))
+				{
+					config::read_guard guard;
+					sum += guard.get(c_snapshot_first);
+					++count;
+				}
+				harness::keep(sum);
+				reads.fetch_add(count);
+			});
+		}
+
+		int publishes = 0;
+		const auto end = std::chrono::steady_clock::now() + DURATION;
+		while (std::chrono::steady_clock::now() < end)
+		{
+			c_snapshot_first.set(++publishes);
+			config::publish();
+		}
+		done = true;
+		for (auto& reader : readers)
+			reader.join();
+
+		const double seconds = std::chrono::duration<double>(DURATION).count();
+		harness::report(std::to_string(threads) + " reader threads, reads", double(reads) / seconds / 1e6, "M/s");
+		harness::report(std::to_string(threads) + " reader threads, publishes", double(publishes) / seconds / 1e3, "k/s");
+	}
+}
@@ -0,0 +1,77 @@
+#include "harness.h"
+#include "config.h"
+#include "stats.h"
+
+namespace
+{
+	ADD_CFG_ITEM(int, count, 3, counted);
+	ADD_CFG_ITEM(float, ratio, 0.5f, counted);
+
+	uint64_t counter(const config::stats::snapshot_t& snapshot, const config::stats::counter_t counter)
+	{
+		return snapshot.counters[counter];
+	}
+}
+
+TEST_CASE(stats_count_loads_and_saves)
+{
+	using namespace config::stats;
+	const auto dir = harness::temp_dir("counted");
+	config::set_config_directory(dir.string());
+
+	reset();
+	CHECK(config::save("written"));
+	snapshot_t stats = get();
+	CHECK(counter(stats, BYTES_WRITTEN) == harness::read_file(dir / "written").size());
+	CHECK(stats.phases[PHASE_WRITE].count == 1 && stats.phases[PHASE_CONVERT].count == 1);
+
+	// two known keys, one unknown and one value the codec rejects
+	const std::string text = "[counted]\ncount=7\nratio=0.25\nmissing=1\n[Counted]\ncount=seven\n";
+	harness::write_file(dir / "read", text);
+	reset();
+	CHECK(config::load_settings("read"));
+	stats = get();
+	CHECK(counter(stats, BYTES_READ) == text.size());
+	CHECK(counter(stats, ITEMS_PARSED) == 2);
+	CHECK(counter(stats, UNKNOWN_KEYS) == 1);
+	CHECK(counter(stats, PARSE_ERRORS) == 1);
+	CHECK(counter(stats, LOOKUPS) == 4);
+	CHECK(counter(stats, CACHE_HITS) == 0);
+	CHECK(stats.phases[PHASE_READ].count == 1 && stats.phases[PHASE_WRITE].count == 0);
+	CHECK(c_counted_count.get() == 7 && c_counted_ratio.get() == 0.25f);
+
+	const std::string text_dump = dump(stats);
+	CHECK(text_dump.find("items_parsed 2\n") != std::string::npos);
+	CHECK(text_dump.find("phase_read count 1") != std::string::npos);
+}
+
+TEST_CASE(stats_percentiles_follow_buckets)
+{
+	using namespace config::stats;
+	reset();
+	for (int i = 0; i < 99; ++i)
+		record(PHASE_DISPATCH, std::chrono::nanoseconds(100));
+	record(PHASE_DISPATCH, std::chrono::milliseconds(1));
+
+	const histogram_t histogram = get().phases[PHASE_DISPATCH];
+	CHECK(histogram.count == 100 && histogram.max_ns == 1'000'000);
+	CHECK(histogram.percentile_ns(0.5) >= 100 && histogram.percentile_ns(0.5) < 256);
+	CHECK(histogram.percentile_ns(1.0) >= 1'000'000);
+	reset();
+}
+
+BENCH_CASE(stats_overhead)
+{
+	using namespace config::stats;
+	const double counter_ns = harness::time_per_op(10'000'000, [](size_t) { add(LOOKUPS); });
+	const double record_ns = harness::time_per_op(1'000'000, [](size_t i) { record(PHASE_LOOKUP, std::chrono::nanoseconds(i)); });
+	const double timer_ns = harness::time_per_op(1'000'000, [](size_t) {
+		config::stats::timer_t timer(PHASE_LOOKUP);
+		timer.switch_to(PHASE_CONVERT);
+	});
+	reset();
+
+	harness::report("counter add", counter_ns, "ns");
+	harness::report("histogram record", record_ns, "ns");
+	harness::report("timer with one switch", timer_ns, "ns");
+}
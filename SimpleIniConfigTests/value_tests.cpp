@@ -0,0 +1,68 @@
+#include "harness.h"
+#include "config.h"
+
+namespace
+{
+	struct custom_t
+	{
+		int a = 0;
+		std::string b;
+	};
+
+	ADD_CFG_ITEM(int, number, 3, values);
+	ADD_CFG_ITEM(float, ratio, 0.5f, values);
+	ADD_CFG_ITEM(std::vector<float>, floats, std::vector<float>(8, 1.0f), values);
+	ADD_CFG_ITEM(custom_t, custom, (custom_t{ 1, "one" }), values);
+
+	// the storage before value_t, a static vector of std::any behind an out of line accessor
+	std::vector<std::any>& any_items();
+}
+
+TEST_CASE(values_store_builtin_types_inline)
+{
+	auto& item = config::get_item(c_values_number);
+	CHECK(std::holds_alternative<int>(item.m_var));
+	CHECK(std::holds_alternative<std::any>(config::get_item(c_values_custom).m_var));
+
+	// assigning keeps the storage, so handles stay valid
+	const int* before = &c_values_number.get();
+	item.set(7);
+	CHECK(&c_values_number.get() == before && *before == 7);
+	CHECK(config::get<int>(c_values_number) == 7);
+
+	c_values_custom.set(custom_t{ 2, "two" });
+	CHECK(config::get<custom_t>(c_values_custom).b == "two");
+	CHECK(config::get_item(c_values_custom).is_dirty());
+}
+
+BENCH_CASE(values_get_latency)
+{
+	constexpr size_t ITERATIONS = 50'000'000;
+	const uint32_t index = c_values_ratio;
+
+	auto& any_values = any_items();
+	any_values.resize(index + 1);
+	any_values[index] = 0.5f;
+
+	float sum = 0.0f;
+	harness::report("std::any_cast (old item storage)", harness::time_per_op(ITERATIONS, [&](size_t) { sum += *std::any_cast<float>(&any_values.at(index)); }), "ns");
+	harness::report("config::get<float>(index)", harness::time_per_op(ITERATIONS, [&](size_t) { sum += config::get<float>(index); }), "ns");
+	harness::report("cfg_handle<float>::get()", harness::time_per_op(ITERATIONS, [&](size_t) { sum += c_values_ratio.get(); }), "ns");
+	harness::report("config::get<std::vector<float>>(index)[0]", harness::time_per_op(ITERATIONS, [&](size_t) { sum += config::get<std::vector<float>>(c_values_floats)[0]; }), "ns");
+	harness::keep(sum);
+
+	// set<t> of the old storage emplaced a new heap copy every time, the variant assigns in place
+	const std::vector<float> values(8, 2.0f);
+	auto& item = config::get_item(c_values_floats);
+	harness::report("std::any::emplace<std::vector<float>>", harness::time_per_op(ITERATIONS / 10, [&](size_t) { any_values[index].emplace<std::vector<float>>(values); }), "ns");
+	harness::report("item_t::set<std::vector<float>>", harness::time_per_op(ITERATIONS / 10, [&](size_t) { item.set(values); }), "ns");
+}
+
+namespace
+{
+	std::vector<std::any>& any_items()
+	{
+		static std::vector<std::any> items;
+		return items;
+	}
+}
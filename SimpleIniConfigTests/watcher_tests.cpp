@@ -0,0 +1,113 @@
+#include "harness.h"
+#include "config.h"
+#include "watcher.h"
+#include <thread>
+
+namespace
+{
+	ADD_CFG_ITEM(int, edited, 1, watched);
+	ADD_CFG_ITEM(int, untouched, 2, watched);
+
+	/// <summary>
+	/// Polls the watcher until a reload changed items or the timeout passed
+	/// </summary>
+	/// <returns>Number of changed items, 0 on timeout</returns>
+	size_t poll_until_reloaded(const std::chrono::milliseconds timeout)
+	{
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		while (std::chrono::steady_clock::now() < deadline)
+		{
+			if (const size_t changed = config::watch::poll())
+				return changed;
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		return 0;
+	}
+
+	/// <summary>
+	/// Replaces the value of edited in the saved file
+	/// </summary>
+	void edit_file(const std::filesystem::path& path, const int value)
+	{
+		std::string text = harness::read_file(path);
+		const size_t start = text.find("edited=") + 7;
+		text.replace(start, text.find('\n', start) - start, std::to_string(value));
+		harness::write_file(path, text);
+	}
+}
+
+TEST_CASE(watcher_reloads_only_changed_items)
+{
+	const auto dir = harness::temp_dir("watched");
+	config::set_config_directory(dir.string());
+	CHECK(config::save("profile"));
+	CHECK(config::load_settings("profile"));
+
+	std::vector<uint32_t> changed;
+	CHECK(config::watch::start([&changed](uint32_t index) { changed.push_back(index); }, std::chrono::milliseconds(5)));
+	const uint64_t reloads = config::watch::get_stats().reloads;
+
+	edit_file(dir / "profile", 5);
+	CHECK(poll_until_reloaded(std::chrono::seconds(5)) == 1);
+	config::watch::stop();
+
+	CHECK(changed == std::vector<uint32_t>{ c_watched_edited.index() });
+	CHECK(c_watched_edited.get() == 5 && c_watched_untouched.get() == 2);
+	CHECK(config::watch::get_stats().reloads == reloads + 1);
+}
+
+TEST_CASE(watcher_reloads_the_loaded_file_after_a_directory_switch)
+{
+	const auto dir = harness::temp_dir("watched_loaded");
+	config::set_config_directory(dir.string());
+	CHECK(config::save("profile"));
+	CHECK(config::load_settings("profile"));
+	CHECK(config::watch::start({}, std::chrono::milliseconds(5)));
+
+	// a file of the same name in the new directory must not be picked up instead
+	const auto other = harness::temp_dir("watched_other");
+	harness::write_file(other / "profile", harness::read_file(dir / "profile"));
+	edit_file(other / "profile", 9);
+	config::set_config_directory(other.string());
+
+	edit_file(dir / "profile", 6);
+	CHECK(poll_until_reloaded(std::chrono::seconds(5)) == 1);
+	config::watch::stop();
+	CHECK(c_watched_edited.get() == 6);
+	config::set_config_directory(dir.string());
+}
+
+BENCH_CASE(watcher_reload_latency)
+{
+	for (size_t i = 0; i < 10000; ++i)
+		config::add_item<float>("value" + std::to_string(i), CT_HASH("float"), float(i), "watchbench");
+
+	const auto dir = harness::temp_dir("watchbench");
+	config::set_config_directory(dir.string());
+	config::save("profile");
+	config::load_settings("profile");
+	config::watch::start();
+
+	// from the end of the write to the changed item being applied by poll
+	constexpr int EDITS = 20;
+	double total = 0.0, worst = 0.0;
+	int applied = 0;
+	for (int i = 0; i < EDITS; ++i)
+	{
+		edit_file(dir / "profile", 100 + i);
+		const auto written = std::chrono::steady_clock::now();
+		if (poll_until_reloaded(std::chrono::seconds(5)) == 0)
+			continue;
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - written).count();
+		total += ms;
+		worst = std::max(worst, ms);
+		++applied;
+	}
+	config::watch::stop();
+
+	const std::string label = " (" + std::to_string(config::get_items().size()) + " items)";
+	harness::report("reloads applied", applied, "of " + std::to_string(EDITS));
+	harness::report("mean write to applied" + label, applied ? total / applied : 0.0, "ms");
+	harness::report("max write to applied" + label, worst, "ms");
+	harness::report("max latency reported by the watcher", double(config::watch::get_stats().max_latency.count()) / 1e3, "ms");
+}